@@ -19,6 +19,11 @@ extern void CRC32C_Update_ARMV8(const byte *s, size_t n, word32& c);
 extern void CRC32C_Update_SSE42(const byte *s, size_t n, word32& c);
 #endif
 
+// crc-simd.cpp
+#if (CRYPTOPP_CLMUL_AVAILABLE)
+extern void CRC32_Update_CLMUL(const byte *s, size_t n, word32& c);
+#endif
+
 /* Table of CRC-32's of all single byte values (made by makecrc.c) */
 const word32 CRC32::m_tab[] = {
 #ifdef CRYPTOPP_LITTLE_ENDIAN
@@ -145,6 +150,16 @@ void CRC32::Update(const byte *s, size_t n)
 	}
 #endif
 
+#if (CRYPTOPP_CLMUL_AVAILABLE)
+	// the folding handles whole 16-byte blocks, the tail goes through the table
+	if (HasCLMUL() && n >= 64)
+	{
+		const size_t folded = n & ~size_t(15);
+		CRC32_Update_CLMUL(s, folded, m_crc);
+		s += folded; n -= folded;
+	}
+#endif
+
 	word32 crc = m_crc;
 
 	for(; !IsAligned<word32>(s) && n > 0; n--)
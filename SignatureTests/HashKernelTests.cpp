@@ -0,0 +1,374 @@
+#include "TestHarness.h"
+#include "SHA256MultiBuffer.h"
+#include "XXH3.h"
+#include "BLAKE3.h"
+#include "HashWrappers.h"
+#include "CRCCombiner.h"
+
+#include "../CryptoPP/sha.h"
+#include "../CryptoPP/crc.h"
+#include "../CryptoPP/cpu.h"
+
+namespace {
+
+// -------------------------------------------------------------------------- //
+/*
+	the checks of the hand-written hashing kernels against the reference implementations
+	or the published test vectors, with the kernels of every instruction set the CPU supports
+ */
+// -------------------------------------------------------------------------- //
+
+// the lengths around the ones the padding takes one more block at (55 and 56 bytes, 119 and 120),
+// and the whole blocks; the inputs of a batch differ, and some of the lanes are left unused
+
+void testSHA256MultiBuffer() {
+	forEachSimdLevel([](SimdLevel) {
+		auto lanes = SHA256MultiBuffer::lanes();
+
+		if (!lanes) {
+			return;
+		}
+
+		for (size_t length : { 55, 56, 63, 64, 119, 120 }) {
+			for (auto count : { 1u, 3u, lanes / 2 + 1, lanes - 1, lanes }) {
+				std::vector<std::vector<unsigned char>> inputs;
+				unsigned char digests[SHA256MultiBuffer::s_maxLanes][CryptoPP::SHA256::DIGESTSIZE];
+				const unsigned char* inputPtrs[SHA256MultiBuffer::s_maxLanes];
+				unsigned char* digestPtrs[SHA256MultiBuffer::s_maxLanes];
+
+				for (unsigned int i = 0; i < count; ++i) {
+					inputs.push_back(randomBytes(length, static_cast<unsigned int>(length * 100 + i)));
+					inputPtrs[i] = inputs.back().data();
+					digestPtrs[i] = digests[i];
+				}
+
+				SHA256MultiBuffer::hash(inputPtrs, length, digestPtrs, count);
+
+				for (unsigned int i = 0; i < count; ++i) {
+					unsigned char expected[CryptoPP::SHA256::DIGESTSIZE];
+
+					CryptoPP::SHA256().CalculateDigest(expected, inputs[i].data(), length);
+
+					CHECK(std::equal(expected, expected + sizeof(expected), digests[i]));
+				}
+			}
+		}
+	});
+}
+
+// -------------------------------------------------------------------------- //
+
+// the test vectors of xxHash: the hashes of the first bytes of the sanity buffer of xxhsum,
+// with no seed, at the lengths of every branch of the short inputs and around the stripes
+// and the blocks of the long ones
+
+struct XXH3Vector {
+	size_t length;
+	uint64_t hash64;
+	uint64_t hash128High;
+	uint64_t hash128Low;
+};
+
+const XXH3Vector s_xxh3Vectors[] = {
+	{    0, 0x2D06800538D394C2ULL, 0x99AA06D3014798D8ULL, 0x6001C324468D497FULL },
+	{    1, 0xC44BDFF4074EECDBULL, 0xA6CD5E9392000F6AULL, 0xC44BDFF4074EECDBULL },
+	{    2, 0x7A9978044CB8A8BBULL, 0x76750C3C7BF95668ULL, 0x7A9978044CB8A8BBULL },
+	{    3, 0x54247382A8D6B94DULL, 0x20EFC49FF02422EAULL, 0x54247382A8D6B94DULL },
+	{    4, 0xE5DC74BC51848A51ULL, 0x970D585AC632BF8EULL, 0x2E7D8D6876A39FE9ULL },
+	{    6, 0x27B56A84CD2D7325ULL, 0x082AFE0B8162D12AULL, 0x3E7039BDDA43CFC6ULL },
+	{    8, 0x24CCC9ACAA9F65E4ULL, 0x47A7F080D82BB456ULL, 0x64C69CAB4BB21DC5ULL },
+	{    9, 0x14D5001C15DD3F2BULL, 0x564EF6078950D457ULL, 0xED7CCBC501EB7501ULL },
+	{   12, 0xA713DAF0DFBB77E7ULL, 0x6E3EFD8FC7802B18ULL, 0x061A192713F69AD9ULL },
+	{   16, 0x981B17D36C7498C9ULL, 0xC68C368ECF8A9C05ULL, 0x562980258A998629ULL },
+	{   17, 0x796F5ACD3A60F862ULL, 0x955FA78643ED3669ULL, 0xABBC12D11973D7DBULL },
+	{   64, 0x9CB48487720EC49DULL, 0x6D90E81A9B0FD622ULL, 0xEFDB6A44690721A9ULL },
+	{  100, 0x93CD95432B7D483FULL, 0x9B50B05817AB158EULL, 0x5FCBC2E3295F2476ULL },
+	{  128, 0xFCFF24126754D861ULL, 0x39992220E045260AULL, 0xEBB15E34A7FB5AB1ULL },
+	{  129, 0x98F1B0A679A2CA29ULL, 0x03815FC91F1B30B6ULL, 0x86C9E3BC8F0A3B5CULL },
+	{  200, 0xBDDCA58935D7C038ULL, 0xE76FF4780FE18439ULL, 0xEB060F1BB3126F5AULL },
+	{  240, 0x81C3C2B67F568CCFULL, 0xAA4202DAA2769DC8ULL, 0x5C9AAE94C8EBE5A0ULL },
+	{  241, 0xC5A639ECD2030E5EULL, 0x99A80ECF0ECFC647ULL, 0xC5A639ECD2030E5EULL },
+	{  255, 0xE98F979F4ED8A197ULL, 0x961375C87E09EFBCULL, 0xE98F979F4ED8A197ULL },
+	{  256, 0x55DE574AD89D0AC5ULL, 0x8B1C66091423D288ULL, 0x55DE574AD89D0AC5ULL },
+	{  512, 0x617E49599013CB6BULL, 0x18D2D110DCC9BCA1ULL, 0x617E49599013CB6BULL },
+	{ 1023, 0x87A8F7B2F2E22496ULL, 0xE8083E4D83214C3CULL, 0x87A8F7B2F2E22496ULL },
+	{ 1024, 0xDD85C9B5C1109C5CULL, 0x0D30D24071C64C57ULL, 0xDD85C9B5C1109C5CULL },
+	{ 1025, 0xD870C0FA13211C6AULL, 0xFD3EE4FE7F2954C6ULL, 0xD870C0FA13211C6AULL },
+	{ 2048, 0xDD59E2C3A5F038E0ULL, 0xF736557FD47073A5ULL, 0xDD59E2C3A5F038E0ULL },
+	{ 2240, 0x6E73A90539CF2948ULL, 0xCCB134FBFA7CE49DULL, 0x6E73A90539CF2948ULL },
+	{ 2367, 0xCB37AEB9E5D361EDULL, 0xE89C0F6FF369B427ULL, 0xCB37AEB9E5D361EDULL },
+	{ 4099, 0x318D235ABA648B01ULL, 0x56EF94DFD3309161ULL, 0x318D235ABA648B01ULL },
+};
+
+std::vector<unsigned char> sanityBuffer (size_t size) {
+	std::vector<unsigned char> buffer(size);
+	uint64_t byteGen{ 2654435761u };
+
+	for (auto& byte : buffer) {
+		byte = static_cast<unsigned char>(byteGen >> 56);
+		byteGen *= 11400714785074694797ull;
+	}
+
+	return buffer;
+}
+
+// the canonical form of the hashes, the way the digests are stored
+
+void putBigEndian (uint64_t value, unsigned char* out) {
+	for (int i = 7; i >= 0; --i, value >>= 8) {
+		out[i] = static_cast<unsigned char>(value);
+	}
+}
+
+void testXXH3Vectors() {
+	auto buffer = sanityBuffer(s_xxh3Vectors[sizeof(s_xxh3Vectors) / sizeof(s_xxh3Vectors[0]) - 1].length);
+
+	forEachSimdLevel([&buffer](SimdLevel) {
+		for (auto& vector : s_xxh3Vectors) {
+			unsigned char expected[XXH3::s_digestSize128], digest[XXH3::s_digestSize128];
+
+			putBigEndian(vector.hash64, expected);
+			XXH3::hash64(buffer.data(), vector.length, digest);
+
+			CHECK(std::equal(expected, expected + XXH3::s_digestSize64, digest));
+
+			putBigEndian(vector.hash128High, expected);
+			putBigEndian(vector.hash128Low, expected + 8);
+			XXH3::hash128(buffer.data(), vector.length, digest);
+
+			CHECK(std::equal(expected, expected + XXH3::s_digestSize128, digest));
+		}
+	});
+}
+
+// -------------------------------------------------------------------------- //
+
+// the test vectors of BLAKE3 (test_vectors.json), the first 32 bytes of the hashes with no key
+// of the inputs made of the bytes counting up to 250 and over again
+
+struct BLAKE3Vector {
+	size_t length;
+	const char* hash;
+};
+
+const BLAKE3Vector s_blake3Vectors[] = {
+	{      0, "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262" },
+	{      1, "2d3adedff11b61f14c886e35afa036736dcd87a74d27b5c1510225d0f592e213" },
+	{   1023, "10108970eeda3eb932baac1428c7a2163b0e924c9a9e25b35bba72b28f70bd11" },
+	{   1024, "42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7" },
+	{   1025, "d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444" },
+	{   2048, "e776b6028c7cd22a4d0ba182a8bf62205d2ef576467e838ed6f2529b85fba24a" },
+	{   2049, "5f4d72f40d7a5f82b15ca2b2e44b1de3c2ef86c426c95c1af0b6879522563030" },
+	{   3072, "b98cb0ff3623be03326b373de6b9095218513e64f1ee2edd2525c7ad1e5cffd2" },
+	{   3073, "7124b49501012f81cc7f11ca069ec9226cecb8a2c850cfe644e327d22d3e1cd3" },
+	{   4096, "015094013f57a5277b59d8475c0501042c0b642e531b0a1c8f58d2163229e969" },
+	{   4097, "9b4052b38f1c5fc8b1f9ff7ac7b27cd242487b3d890d15c96a1c25b8aa0fb995" },
+	{   5120, "9cadc15fed8b5d854562b26a9536d9707cadeda9b143978f319ab34230535833" },
+	{   5121, "628bd2cb2004694adaab7bbd778a25df25c47b9d4155a55f8fbd79f2fe154cff" },
+	{   6144, "3e2e5b74e048f3add6d21faab3f83aa44d3b2278afb83b80b3c35164ebeca205" },
+	{   6145, "f1323a8631446cc50536a9f705ee5cb619424d46887f3c376c695b70e0f0507f" },
+	{   7168, "61da957ec2499a95d6b8023e2b0e604ec7f6b50e80a9678b89d2628e99ada77a" },
+	{   7169, "a003fc7a51754a9b3c7fae0367ab3d782dccf28855a03d435f8cfe74605e7817" },
+	{   8192, "aae792484c8efe4f19e2ca7d371d8c467ffb10748d8a5a1ae579948f718a2a63" },
+	{   8193, "bab6c09cb8ce8cf459261398d2e7aef35700bf488116ceb94a36d0f5f1b7bc3b" },
+	{  16384, "f875d6646de28985646f34ee13be9a576fd515f76b5b0a26bb324735041ddde4" },
+	{  31744, "62b6960e1a44bcc1eb1a611a8d6235b6b4b78f32e7abc4fb4c6cdcce94895c47" },
+	{ 102400, "bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085" },
+};
+
+std::vector<unsigned char> fromHex (const char* hex) {
+	std::vector<unsigned char> bytes;
+
+	for (; hex[0] && hex[1]; hex += 2) {
+		bytes.push_back(static_cast<unsigned char>(std::stoi(std::string(hex, 2), nullptr, 16)));
+	}
+
+	return bytes;
+}
+
+void testBLAKE3Vectors() {
+	std::vector<unsigned char> input(s_blake3Vectors[sizeof(s_blake3Vectors) / sizeof(s_blake3Vectors[0]) - 1].length);
+
+	for (size_t i = 0; i < input.size(); ++i) {
+		input[i] = static_cast<unsigned char>(i % 251);
+	}
+
+	forEachSimdLevel([&input](SimdLevel) {
+		for (auto& vector : s_blake3Vectors) {
+			auto expected = fromHex(vector.hash);
+			unsigned char digest[BLAKE3::s_digestSize];
+
+			BLAKE3::hash(input.data(), vector.length, digest);
+
+			CHECK(std::equal(expected.begin(), expected.end(), digest));
+		}
+	});
+}
+
+// -------------------------------------------------------------------------- //
+
+// a block shared among the hashers: the parts the wrapper cuts the blocks of no round size into,
+// the last of them a short one, are hashed on their own and make the digest of the whole block
+
+void testBLAKE3Parts() {
+	auto input = randomBytes(1024 * 1024 + 3, 3);
+
+	forEachSimdLevel([&input](SimdLevel) {
+		auto hasher = HashWrapperFactory::createHashWrapper(HashFunctionId::BLAKE3);
+
+		for (size_t size : { 2049, 3 * 1024 + 17, 7169, 10000, 65537, 100000, 1024 * 1024 + 3 }) {
+			unsigned char expected[BLAKE3::s_digestSize];
+
+			hasher->createDigest(input.data(), size, expected);
+
+			for (unsigned int maxParts = 2; maxParts <= 16; ++maxParts) {
+				auto partSize = hasher->partSize(size, maxParts);
+				auto count = (size + partSize - 1) / partSize;
+
+				if (count < 2) {
+					continue;
+				}
+
+				CHECK(count <= maxParts);
+
+				std::vector<unsigned char> results(count * hasher->partResultSize());
+				unsigned char digest[BLAKE3::s_digestSize];
+
+				for (size_t i = 0; i < count; ++i) {
+					auto offset = i * partSize;
+
+					hasher->hashPart(input.data() + offset, std::min(partSize, size - offset), offset,
+									 results.data() + i * hasher->partResultSize());
+				}
+
+				hasher->combineParts(results.data(), count, partSize, size, digest);
+
+				CHECK(std::equal(expected, expected + sizeof(expected), digest));
+			}
+		}
+	});
+}
+
+// -------------------------------------------------------------------------- //
+
+// the digests of the CRC wrappers are the little-endian CRC values
+
+uint32_t readCRC (const unsigned char* digest) {
+	return digest[0] | (digest[1] << 8) | (digest[2] << 16) | (static_cast<uint32_t>(digest[3]) << 24);
+}
+
+// a block cut into parts of odd sizes as well as of the ones the wrapper picks, the last part
+// a short one, is hashed part by part, and the CRCs put together must be the CRC of the whole
+
+void checkCRCParts (HashFunctionId id, uint32_t polynomial) {
+	auto input = randomBytes(300000, 4);
+	auto hasher = HashWrapperFactory::createHashWrapper(id);
+	const CRCCombiner combiner{ polynomial };
+
+	for (size_t size : { 2, 4097, 65536, 300000 }) {
+		unsigned char expected[4];
+
+		hasher->createDigest(input.data(), size, expected);
+
+		std::vector<size_t> partSizes{ 1, 3, 255, 4095, 4097, 10001, 65537 };
+
+		for (unsigned int maxParts = 2; maxParts <= 16; maxParts *= 2) {
+			partSizes.push_back(hasher->partSize(size, maxParts));
+		}
+
+		for (auto partSize : partSizes) {
+			auto count = (size + partSize - 1) / partSize;
+
+			if (count < 2) {
+				continue;
+			}
+
+			std::vector<unsigned char> results(count * hasher->partResultSize());
+			unsigned char digest[4];
+
+			for (size_t i = 0; i < count; ++i) {
+				auto offset = i * partSize;
+
+				hasher->hashPart(input.data() + offset, std::min(partSize, size - offset), offset,
+								 results.data() + i * hasher->partResultSize());
+			}
+
+			hasher->combineParts(results.data(), count, partSize, size, digest);
+
+			CHECK(std::equal(expected, expected + sizeof(expected), digest));
+
+			// the same with the combiner alone, one part after another
+
+			auto crc = readCRC(results.data());
+
+			for (size_t i = 1; i < count; ++i) {
+				crc = combiner.combine(crc, readCRC(results.data() + i * 4), std::min(partSize, size - i * partSize));
+			}
+
+			CHECK(crc == readCRC(expected));
+		}
+	}
+}
+
+void testCRCParts() {
+	checkCRCParts(HashFunctionId::CRC32, CRCCombiner::s_crc32Polynomial);
+	checkCRCParts(HashFunctionId::CRC32C, CRCCombiner::s_crc32cPolynomial);
+}
+
+// -------------------------------------------------------------------------- //
+
+// the CRC32C of CryptoPP's table-driven code, the SSE4.2 one turned off for the time
+
+uint32_t scalarCRC32C (const unsigned char* input, size_t size) {
+	unsigned char digest[CryptoPP::CRC32C::DIGESTSIZE];
+
+#if CRYPTOPP_SSE42_AVAILABLE
+	struct FeatureReset {
+		bool hasSSE42{ CryptoPP::HasSSE42() };
+
+		~FeatureReset() { CryptoPP::g_hasSSE42 = hasSSE42; }
+	} reset;
+
+	CryptoPP::g_hasSSE42 = false;
+#endif
+
+	CryptoPP::CRC32C().CalculateDigest(digest, input, size);
+
+	return readCRC(digest);
+}
+
+// the SSE4.2 kernel runs three streams of 4096 and then of 256 bytes side by side, the lengths
+// around the multiples of those take all the ways through it, from the unaligned starts as well
+
+void testCRC32CStreams() {
+	auto input = randomBytes(3 * (3 * 4096 + 3 * 256) + 64, 5);
+
+	for (size_t stride : { 256, 4096, 4096 + 256 }) {
+		for (size_t multiple = 1; multiple <= 3; ++multiple) {
+			for (size_t size = 3 * stride * multiple - 9; size <= 3 * stride * multiple + 9; ++size) {
+				for (size_t start = 0; start < 4; ++start) {
+					unsigned char digest[CryptoPP::CRC32C::DIGESTSIZE];
+
+					CryptoPP::CRC32C().CalculateDigest(digest, input.data() + start, size);
+
+					CHECK(readCRC(digest) == scalarCRC32C(input.data() + start, size));
+				}
+			}
+		}
+	}
+}
+
+}
+
+// -------------------------------------------------------------------------- //
+
+std::vector<test_t> hashKernelTests() {
+	return {
+		{ "testSHA256MultiBuffer", &testSHA256MultiBuffer },
+		{ "testXXH3Vectors", &testXXH3Vectors },
+		{ "testBLAKE3Vectors", &testBLAKE3Vectors },
+		{ "testBLAKE3Parts", &testBLAKE3Parts },
+		{ "testCRCParts", &testCRCParts },
+		{ "testCRC32CStreams", &testCRC32CStreams },
+	};
+}
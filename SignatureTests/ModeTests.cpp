@@ -0,0 +1,501 @@
+#include "TestHarness.h"
+#include "SignatureFile.h"
+#include "SignatureDiff.h"
+
+namespace {
+
+// -------------------------------------------------------------------------- //
+/*
+	the checks of the ways the tool works besides signing a file from start to end: verifying
+	a file, comparing two signatures, updating a signature, and the inputs of a special kind,
+	the sparse ones, the ones of uniform blocks and the ones cut into chunks; the results are
+	checked against the ones worked out from the data by brute force
+ */
+// -------------------------------------------------------------------------- //
+
+constexpr uint32_t s_blockSize{ 4096 };
+
+// -------------------------------------------------------------------------- //
+
+// the ranges of the blocks marked
+
+std::vector<block_range_t> rangesOf (const std::vector<bool>& marked) {
+	std::vector<block_range_t> ranges;
+
+	for (uint64_t block = 0; block < marked.size(); ++block) {
+		if (!marked[static_cast<size_t>(block)]) {
+			continue;
+		}
+
+		if (!ranges.empty() && ranges.back().second + 1 == block) {
+			ranges.back().second = block;
+		} else {
+			ranges.emplace_back(block, block);
+		}
+	}
+
+	return ranges;
+}
+
+void sign (const TempFile& input, const TempFile& output, const SignatureOptions& options = {},
+		   HashFunctionId id = HashFunctionId::MD5, uint32_t blockSize = s_blockSize) {
+	FileSignatureCreator{ input.string().c_str(), output.string().c_str(), blockSize, id, options };
+}
+
+// -------------------------------------------------------------------------- //
+
+// the file matches the signature made of it in every reading mode, and its blocks changed
+// afterwards are the ones found not to
+
+void testVerify() {
+	TempFile input{ "ModeTests.in" };
+	TempFile output{ "ModeTests.sig" };
+
+	auto data = randomBytes(s_blockSize * 20 + 1000, 1);
+
+	writeFile(input.get(), data);
+	sign(input, output);
+
+	for (auto readMode : { ReadMode::Stream, ReadMode::Mapped, ReadMode::Async }) {
+		SignatureOptions options;
+
+		options.readMode = readMode;
+
+		FileSignatureVerifier verifier{ input.string().c_str(), output.string().c_str(), options };
+
+		CHECK(verifier.result().passed());
+		CHECK(!verifier.result().stoppedEarly);
+		CHECK(verifier.result().hashFunctionId == HashFunctionId::MD5);
+		CHECK(verifier.result().blockSize == s_blockSize);
+	}
+
+	std::vector<bool> changed(20 + 1);
+
+	for (size_t block : { 2, 5, 6, 20 }) {
+		data[block * s_blockSize + 7] ^= 0xFF;
+		changed[block] = true;
+	}
+
+	writeFile(input.get(), data);
+
+	FileSignatureVerifier verifier{ input.string().c_str(), output.string().c_str() };
+
+	CHECK(!verifier.result().passed());
+	CHECK(verifier.result().sizeMatches);
+	CHECK(verifier.result().mismatches == rangesOf(changed));
+
+	// a file of another size doesn't match whatever its blocks are
+
+	data.pop_back();
+	writeFile(input.get(), data);
+
+	CHECK(!FileSignatureVerifier(input.string().c_str(), output.string().c_str()).result().sizeMatches);
+}
+
+// -------------------------------------------------------------------------- //
+
+// the verification stopping at the first mismatch tells so, and whatever mismatches it has found
+// by then are real ones
+
+void testVerifyFailFast() {
+	TempFile input{ "ModeTests.in" };
+	TempFile output{ "ModeTests.sig" };
+
+	auto data = randomBytes(s_blockSize * 200, 2);
+
+	writeFile(input.get(), data);
+	sign(input, output);
+
+	std::vector<bool> changed(200);
+
+	for (size_t block = 0; block < changed.size(); block += 3) {
+		data[block * s_blockSize] ^= 0xFF;
+		changed[block] = true;
+	}
+
+	writeFile(input.get(), data);
+
+	SignatureOptions options;
+
+	options.failFast = true;
+
+	FileSignatureVerifier verifier{ input.string().c_str(), output.string().c_str(), options };
+	auto& result = verifier.result();
+
+	CHECK(!result.passed());
+	CHECK(result.stoppedEarly);
+	CHECK(!result.mismatches.empty());
+
+	for (auto& range : result.mismatches) {
+		for (auto block = range.first; block <= range.second; ++block) {
+			CHECK(block < changed.size() && changed[static_cast<size_t>(block)]);
+		}
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+// two signatures of the files of different sizes, with and without the Merkle trees:
+// the blocks whose digests differ are changed, and so are the ones of the longer file only,
+// as well as the last block of the shorter one unless it's a whole one
+
+void checkDiff (const std::vector<unsigned char>& oldData, const std::vector<unsigned char>& newData) {
+	TempFile oldInput{ "ModeTests.old" };
+	TempFile newInput{ "ModeTests.new" };
+	TempFile oldOutput{ "ModeTests.old.sig" };
+	TempFile newOutput{ "ModeTests.new.sig" };
+
+	writeFile(oldInput.get(), oldData);
+	writeFile(newInput.get(), newData);
+
+	auto oldDigests = blockDigests(oldData, s_blockSize, HashFunctionId::MD5);
+	auto newDigests = blockDigests(newData, s_blockSize, HashFunctionId::MD5);
+
+	const size_t digestSize = HashTraits::digestSize(HashFunctionId::MD5);
+	const auto oldBlocks = oldDigests.size() / digestSize, newBlocks = newDigests.size() / digestSize;
+	const auto commonBlocks = std::min(oldBlocks, newBlocks);
+
+	std::vector<bool> changed(std::max(oldBlocks, newBlocks));
+
+	for (size_t block = 0; block < changed.size(); ++block) {
+		changed[block] = block >= commonBlocks ||
+						 !std::equal(oldDigests.begin() + block * digestSize, oldDigests.begin() + (block + 1) * digestSize,
+									 newDigests.begin() + block * digestSize);
+	}
+
+	auto shorterSize = std::min(oldData.size(), newData.size());
+
+	if (oldData.size() != newData.size() && shorterSize % s_blockSize) {
+		changed[commonBlocks - 1] = true;
+	}
+
+	for (auto merkleTree : { false, true }) {
+		SignatureOptions options;
+
+		options.merkleTree = merkleTree;
+
+		sign(oldInput, oldOutput, options);
+		sign(newInput, newOutput, options);
+
+		SignatureDiff diff{ oldOutput.string().c_str(), newOutput.string().c_str() };
+
+		CHECK(diff.blockSize() == s_blockSize);
+		CHECK(diff.changes() == rangesOf(changed));
+	}
+}
+
+void testDiff() {
+	auto oldData = randomBytes(s_blockSize * 300 + 100, 3);
+	auto newData = oldData;
+
+	for (size_t block : { 0, 17, 18, 19, 150, 299 }) {
+		newData[block * s_blockSize + 11] ^= 0x01;
+	}
+
+	checkDiff(oldData, newData);
+
+	// the new file grows, with a whole last block and then with a short one
+
+	auto longer = newData;
+
+	longer.resize(s_blockSize * 310, 0x5A);
+	checkDiff(oldData, longer);
+
+	longer.resize(s_blockSize * 310 + 1);
+	checkDiff(oldData, longer);
+
+	// the new file shrinks to a short last block, and then the old one is the shorter one
+
+	auto shorter = newData;
+
+	shorter.resize(s_blockSize * 200 + 5);
+	checkDiff(oldData, shorter);
+	checkDiff(shorter, oldData);
+}
+
+// -------------------------------------------------------------------------- //
+
+// the signature updated out of the base one is the one made afresh to the byte,
+// whether the dirty ranges are told or the file is taken as unchanged by its write time
+
+void checkUpdate (const SignatureOptions& options) {
+	TempFile input{ "ModeTests.in" };
+	TempFile base{ "ModeTests.base.sig" };
+	TempFile updated{ "ModeTests.updated.sig" };
+	TempFile fresh{ "ModeTests.fresh.sig" };
+
+	auto data = randomBytes(s_blockSize * 100 + 55, 4);
+
+	writeFile(input.get(), data);
+	sign(input, base, options, HashFunctionId::SHA256);
+
+	// an unchanged file
+
+	FileSignatureUpdater{ input.string().c_str(), updated.string().c_str(), base.string().c_str(), ChangeHint{}, options };
+	sign(input, fresh, options, HashFunctionId::SHA256);
+
+	CHECK(readFile(updated.get()) == readFile(fresh.get()));
+
+	// the ranges told cross the block boundaries, and one of them takes in the short last block
+
+	ChangeHint hint;
+
+	hint.rangesKnown = true;
+	hint.dirtyRanges = { { s_blockSize * 3 - 10, 20 }, { s_blockSize * 40, s_blockSize * 2 }, { data.size() - 30, 30 } };
+
+	for (auto& range : hint.dirtyRanges) {
+		for (auto offset = range.first; offset < range.first + range.second; ++offset) {
+			data[static_cast<size_t>(offset)] ^= 0x80;
+		}
+	}
+
+	writeFile(input.get(), data);
+
+	FileSignatureUpdater{ input.string().c_str(), updated.string().c_str(), base.string().c_str(), hint, options };
+	sign(input, fresh, options, HashFunctionId::SHA256);
+
+	CHECK(readFile(updated.get()) == readFile(fresh.get()));
+}
+
+void testUpdate() {
+	SignatureOptions options;
+
+	options.merkleTree = true;
+	options.weakChecksums = true;
+
+	checkUpdate(options);
+
+	options.sectioned = true;
+	options.blockContents = true;
+
+	checkUpdate(options);
+}
+
+// -------------------------------------------------------------------------- //
+
+// the holes of a sparse file are read as the zeros they are, in every reading mode
+
+void testSparseInput() {
+	TempFile sparse{ "ModeTests.sparse" };
+	TempFile dense{ "ModeTests.dense" };
+	TempFile sparseOutput{ "ModeTests.sparse.sig" };
+	TempFile denseOutput{ "ModeTests.dense.sig" };
+
+	const uint32_t blockSize{ 64 * 1024 };
+	const size_t megabyte{ 1024 * 1024 };
+
+	auto head = randomBytes(megabyte, 5);
+	auto middle = randomBytes(100000, 6);
+
+	// the data, a hole, some more data not ending at a block boundary and a hole up to the end
+
+	{
+		std::ofstream ofs{ sparse.get(), std::ios_base::out | std::ios_base::binary };
+
+		ofs.write(reinterpret_cast<const char*>(head.data()), head.size());
+		ofs.seekp(3 * megabyte);
+		ofs.write(reinterpret_cast<const char*>(middle.data()), middle.size());
+	}
+
+	resize_file(sparse.get(), 5 * megabyte);
+
+	std::vector<unsigned char> data(5 * megabyte);
+
+	std::copy(head.begin(), head.end(), data.begin());
+	std::copy(middle.begin(), middle.end(), data.begin() + 3 * megabyte);
+
+	writeFile(dense.get(), data);
+	sign(dense, denseOutput, {}, HashFunctionId::XXH3, blockSize);
+
+	auto expected = readFile(denseOutput.get());
+
+	for (auto readMode : { ReadMode::Stream, ReadMode::Mapped, ReadMode::Async }) {
+		SignatureOptions options;
+
+		options.readMode = readMode;
+
+		sign(sparse, sparseOutput, options, HashFunctionId::XXH3, blockSize);
+
+		CHECK(readFile(sparseOutput.get()) == expected);
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+// the blocks of zeros and of a pattern repeated get the digests of their contents, whether
+// the patterns are looked for or not, and a block just missing a pattern is hashed as it is
+
+void testUniformBlocks() {
+	TempFile input{ "ModeTests.in" };
+	TempFile output{ "ModeTests.sig" };
+
+	auto data = randomBytes(s_blockSize * 12 + 100, 7);
+	auto fill = [&data](size_t block, size_t size, const std::vector<unsigned char>& pattern) {
+		for (size_t i = 0; i < size; ++i) {
+			data[block * s_blockSize + i] = pattern[i % pattern.size()];
+		}
+	};
+
+	const std::vector<unsigned char> zero(1), byte(1, 0xAB);
+	const auto word = randomBytes(16, 8), sector = randomBytes(512, 9);
+
+	const BlockContent contents[] = {
+		BlockContent::Zeros, BlockContent::Pattern, BlockContent::Pattern, BlockContent::Data,
+		BlockContent::Pattern, BlockContent::Zeros, BlockContent::Data, BlockContent::Pattern,
+		BlockContent::Data, BlockContent::Data, BlockContent::Zeros, BlockContent::Data,
+		BlockContent::Zeros
+	};
+
+	fill(0, s_blockSize, zero);
+	fill(1, s_blockSize, byte);
+	fill(2, s_blockSize, word);
+	fill(4, s_blockSize, sector);
+	fill(5, s_blockSize, zero);
+	fill(6, s_blockSize, sector);
+	data[6 * s_blockSize + s_blockSize - 1] ^= 1;
+	fill(7, s_blockSize, word);
+	fill(10, s_blockSize, zero);
+	fill(11, s_blockSize, zero);
+	data[11 * s_blockSize] = 1;
+	fill(12, 100, zero);
+
+	writeFile(input.get(), data);
+
+	auto digests = blockDigests(data, s_blockSize, HashFunctionId::BLAKE3);
+
+	forEachSimdLevel([&](SimdLevel) {
+		for (auto detectPatterns : { false, true }) {
+			SignatureOptions options;
+
+			options.detectPatterns = detectPatterns;
+			options.blockContents = true;
+
+			sign(input, output, options, HashFunctionId::BLAKE3);
+
+			SignatureFile signature{ output.get() };
+
+			CHECK(std::equal(digests.begin(), digests.end(), signature.digests()));
+
+			for (uint64_t block = 0; block < signature.blockCount(); ++block) {
+				auto expected = contents[block];
+
+				if (expected == BlockContent::Pattern && !detectPatterns) {
+					expected = BlockContent::Data;
+				}
+
+				CHECK(signature.blockContent(block) == expected);
+			}
+		}
+	});
+}
+
+// -------------------------------------------------------------------------- //
+
+// the chunks follow each other from the start of the file to its end, every one of them
+// of the sizes allowed but the last one, with the digest of its data
+
+void testChunkRecords() {
+	TempFile input{ "ModeTests.in" };
+	TempFile output{ "ModeTests.sig" };
+
+	auto data = randomBytes(3 * 1024 * 1024 + 777, 10);
+
+	writeFile(input.get(), data);
+
+	ChunkSizes sizes;
+
+	sizes.minSize = 1024;
+	sizes.averageSize = 4096;
+	sizes.maxSize = 16 * 1024;
+
+	forEachSimdLevel([&](SimdLevel) {
+		FileSignatureCreator{ input.string().c_str(), output.string().c_str(), sizes, HashFunctionId::XXH128 };
+
+		SignatureFile signature{ output.get() };
+		auto hasher = HashWrapperFactory::createHashWrapper(HashFunctionId::XXH128);
+		hash_t digest(hasher->digestSize());
+		uint64_t offset{ 0 };
+
+		CHECK(signature.isChunked());
+		CHECK(signature.chunkCount() > 1);
+
+		for (uint64_t i = 0; i < signature.chunkCount(); ++i) {
+			auto chunk = signature.chunk(i);
+
+			CHECK(chunk.first == offset);
+			CHECK(chunk.second <= sizes.maxSize);
+			CHECK(chunk.second >= sizes.minSize || i + 1 == signature.chunkCount());
+
+			hasher->createDigest(data.data() + offset, static_cast<size_t>(chunk.second), digest);
+
+			CHECK(std::equal(digest.begin(), digest.end(), signature.chunkDigest(i)));
+
+			offset += chunk.second;
+		}
+
+		CHECK(offset == data.size());
+	});
+}
+
+// -------------------------------------------------------------------------- //
+
+// the sum of the bytes and the sum of them weighted by their distance from the end of the block,
+// the lower halves of both
+
+uint32_t weakChecksum (const unsigned char* data, size_t size) {
+	uint32_t sum{ 0 }, weightedSum{ 0 };
+
+	for (size_t i = 0; i < size; ++i) {
+		sum += data[i];
+		weightedSum += static_cast<uint32_t>(size - i) * data[i];
+	}
+
+	return (weightedSum << 16) | (sum & 0xFFFF);
+}
+
+void testWeakChecksums() {
+	TempFile input{ "ModeTests.in" };
+	TempFile output{ "ModeTests.sig" };
+
+	// the block size isn't a multiple of any vector width, nor is the last block
+
+	const uint32_t blockSize{ 4096 + 13 };
+
+	auto data = randomBytes(blockSize * 30 + 333, 11);
+
+	std::fill(data.begin(), data.begin() + blockSize, static_cast<unsigned char>(0xFF));
+	writeFile(input.get(), data);
+
+	forEachSimdLevel([&](SimdLevel) {
+		SignatureOptions options;
+
+		options.weakChecksums = true;
+
+		sign(input, output, options, HashFunctionId::CRC32, blockSize);
+
+		SignatureFile signature{ output.get() };
+
+		for (uint64_t block = 0; block < signature.blockCount(); ++block) {
+			auto offset = static_cast<size_t>(block * blockSize);
+
+			CHECK(signature.weakChecksum(block) == weakChecksum(data.data() + offset, std::min<size_t>(blockSize, data.size() - offset)));
+		}
+	});
+}
+
+}
+
+// -------------------------------------------------------------------------- //
+
+std::vector<test_t> modeTests() {
+	return {
+		{ "testVerify", &testVerify },
+		{ "testVerifyFailFast", &testVerifyFailFast },
+		{ "testDiff", &testDiff },
+		{ "testUpdate", &testUpdate },
+		{ "testSparseInput", &testSparseInput },
+		{ "testUniformBlocks", &testUniformBlocks },
+		{ "testChunkRecords", &testChunkRecords },
+		{ "testWeakChecksums", &testWeakChecksums },
+	};
+}
@@ -0,0 +1,313 @@
+#include "TestHarness.h"
+#include "SignatureFile.h"
+
+namespace {
+
+// -------------------------------------------------------------------------- //
+/*
+	the checks of the signature formats written: every test signs an input file of its own
+	made in the temporary directory, and either compares the signature to the one expected
+	byte by byte or reads it back
+ */
+// -------------------------------------------------------------------------- //
+
+constexpr uint32_t s_blockSize{ 4096 };
+
+// -------------------------------------------------------------------------- //
+
+// the input is made of some blocks of pseudo-random bytes, the last of them a short one
+
+std::vector<unsigned char> makeInput (const TempFile& file) {
+	auto data = randomBytes(s_blockSize * 10 + 123, 2018);
+
+	writeFile(file.get(), data);
+
+	return data;
+}
+
+// -------------------------------------------------------------------------- //
+
+// with nothing but the digests asked for, the signature is the one of the version 1 to the byte:
+// the header with no flags and the reserved fields of zeros, followed by the digests alone
+
+void testVersion1 (HashFunctionId id, const SignatureOptions& options) {
+	TempFile input{ "SignatureFormatTests.in" };
+	TempFile output{ "SignatureFormatTests.sig" };
+
+	auto data = makeInput(input);
+
+	FileSignatureCreator{ input.string().c_str(), output.string().c_str(), s_blockSize, id, options };
+
+	std::vector<unsigned char> expected;
+
+	auto put = [&expected](const auto& field) {
+		auto bytes = reinterpret_cast<const unsigned char*>(&field);
+
+		expected.insert(expected.end(), bytes, bytes + sizeof(field));
+	};
+
+	put(SignatureHeader{}.fileMark);
+	put(uint16_t{ 1 });
+	put(static_cast<uint16_t>(id));
+	put(static_cast<uint64_t>(data.size()));
+	put(s_blockSize);
+	put(uint32_t{ 0 });
+	put(uint32_t{ 0 });
+	put(uint32_t{ 0 });
+
+	auto digests = blockDigests(data, s_blockSize, id);
+
+	expected.insert(expected.end(), digests.begin(), digests.end());
+
+	CHECK(readFile(output.get()) == expected);
+}
+
+// -------------------------------------------------------------------------- //
+
+void testVersion1Default() {
+	testVersion1(HashFunctionId::CRC32, {});
+	testVersion1(HashFunctionId::SHA256, {});
+	testVersion1(HashFunctionId::BLAKE3, {});
+}
+
+// -------------------------------------------------------------------------- //
+
+void testVersion1MappedOutput() {
+	SignatureOptions options;
+
+	options.mappedOutput = true;
+
+	testVersion1(HashFunctionId::XXH3, options);
+}
+
+// -------------------------------------------------------------------------- //
+
+// whatever is asked for besides the digests makes the version 2, and is told by the flags
+
+void testVersion2 (const SignatureOptions& options, uint32_t flags) {
+	TempFile input{ "SignatureFormatTests.in" };
+	TempFile output{ "SignatureFormatTests.sig" };
+
+	auto data = makeInput(input);
+
+	FileSignatureCreator{ input.string().c_str(), output.string().c_str(), s_blockSize, HashFunctionId::MD5, options };
+
+	SignatureFile signature{ output.get() };
+	auto digests = blockDigests(data, s_blockSize, HashFunctionId::MD5);
+
+	CHECK(signature.header().formatVersion == 2);
+	CHECK(signature.header().flags == flags);
+	CHECK(std::equal(digests.begin(), digests.end(), signature.digests()));
+}
+
+// -------------------------------------------------------------------------- //
+
+void testVersion2Options() {
+	SignatureOptions options;
+
+	options.merkleTree = true;
+
+	testVersion2(options, SignatureFlags::MerkleTree);
+
+	options.merkleTree = false;
+	options.weakChecksums = true;
+
+	testVersion2(options, SignatureFlags::WeakChecksums);
+}
+
+// -------------------------------------------------------------------------- //
+
+// the sections are only written if asked for, even with no flags
+
+void testSectionedNoFlags() {
+	TempFile input{ "SignatureFormatTests.in" };
+	TempFile output{ "SignatureFormatTests.sig" };
+
+	auto data = makeInput(input);
+
+	SignatureOptions options;
+
+	options.sectioned = true;
+
+	FileSignatureCreator{ input.string().c_str(), output.string().c_str(), s_blockSize, HashFunctionId::CRC32C, options };
+
+	SignatureFile signature{ output.get() };
+	auto digests = blockDigests(data, s_blockSize, HashFunctionId::CRC32C);
+
+	CHECK(signature.isSectioned());
+	CHECK(!signature.header().flags);
+	CHECK(std::equal(digests.begin(), digests.end(), signature.digests()));
+}
+
+// -------------------------------------------------------------------------- //
+
+// reads the section table of the version 4 the way it's written, field by field
+
+std::vector<SignatureSection> readSectionTable (const std::vector<unsigned char>& file, uint32_t& entrySize) {
+	auto pos = file.data() + SignatureHeaderTraits::size();
+	auto get = [&pos](auto& field) {
+		std::memcpy(&field, pos, sizeof(field));
+		pos += sizeof(field);
+	};
+
+	uint32_t sectionCount;
+
+	get(sectionCount);
+	get(entrySize);
+
+	std::vector<SignatureSection> sections(sectionCount);
+
+	for (auto& section : sections) {
+		get(section.id);
+		get(section.itemSize);
+		get(section.offset);
+		get(section.size);
+	}
+
+	return sections;
+}
+
+// every section is there in the order of the kinds, at a page boundary past the one before it,
+// and holds what the flags call for
+
+void testSectionTable() {
+	TempFile input{ "SignatureFormatTests.in" };
+	TempFile output{ "SignatureFormatTests.sig" };
+
+	auto data = makeInput(input);
+
+	SignatureOptions options;
+
+	options.sectioned = true;
+	options.merkleTree = true;
+	options.weakChecksums = true;
+	options.blockContents = true;
+
+	FileSignatureCreator{ input.string().c_str(), output.string().c_str(), s_blockSize, HashFunctionId::SHA256, options };
+
+	auto file = readFile(output.get());
+	uint32_t entrySize;
+	auto sections = readSectionTable(file, entrySize);
+
+	const uint64_t blockCount = (data.size() + s_blockSize - 1) / s_blockSize;
+	const unsigned int digestSize = HashTraits::digestSize(HashFunctionId::SHA256);
+
+	const SignatureSection expected[] = {
+		{ SignatureSectionId::Digests, digestSize, 0, blockCount * digestSize },
+		{ SignatureSectionId::BlockContents, 1, 0, blockCount },
+		{ SignatureSectionId::MerkleLevels, digestSize, 0, (MerkleTreeLayout{ blockCount }.nodeCount() - blockCount) * digestSize },
+		{ SignatureSectionId::WeakChecksums, RollingChecksum::s_size, 0, blockCount * RollingChecksum::s_size },
+	};
+
+	CHECK(entrySize == SignatureHeaderTraits::sectionEntrySize());
+	CHECK(sections.size() == sizeof(expected) / sizeof(expected[0]));
+
+	uint64_t sectionsEnd = SignatureHeaderTraits::size() + SignatureHeaderTraits::sectionTableHeaderSize() +
+						   sections.size() * entrySize;
+
+	for (size_t i = 0; i < sections.size(); ++i) {
+		CHECK(sections[i].id == expected[i].id);
+		CHECK(sections[i].itemSize == expected[i].itemSize);
+		CHECK(sections[i].size == expected[i].size);
+		CHECK(sections[i].offset % SignatureHeaderTraits::sectionAlignment() == 0);
+		CHECK(sections[i].offset >= sectionsEnd);
+
+		sectionsEnd = sections[i].offset + sections[i].size;
+	}
+
+	CHECK(file.size() == sectionsEnd);
+
+	auto digests = blockDigests(data, s_blockSize, HashFunctionId::SHA256);
+
+	CHECK(std::equal(digests.begin(), digests.end(), file.data() + sections[0].offset));
+
+	// the reader finds the same parts right in the mapped file
+
+	SignatureFile signature{ output.get() };
+
+	auto levels = file.begin() + static_cast<ptrdiff_t>(sections[2].offset);
+
+	CHECK(static_cast<uint64_t>(signature.weakChecksums() - signature.digests()) == sections[3].offset - sections[0].offset);
+	CHECK(std::equal(digests.begin(), digests.end(), signature.digests()));
+	CHECK(std::equal(levels, levels + static_cast<ptrdiff_t>(sections[2].size), signature.node(1, 0)));
+	CHECK(signature.blockContent(0) == BlockContent::Data);
+}
+
+// -------------------------------------------------------------------------- //
+
+// a section of a kind the reader doesn't know about is skipped, wherever it is in the table
+
+void testUnknownSectionSkipped() {
+	TempFile input{ "SignatureFormatTests.in" };
+	TempFile output{ "SignatureFormatTests.sig" };
+
+	auto data = makeInput(input);
+
+	SignatureOptions options;
+
+	options.sectioned = true;
+	options.weakChecksums = true;
+
+	FileSignatureCreator{ input.string().c_str(), output.string().c_str(), s_blockSize, HashFunctionId::MD5, options };
+
+	auto file = readFile(output.get());
+	uint32_t entrySize;
+	auto sections = readSectionTable(file, entrySize);
+
+	// the unknown section goes between the known ones in the table, and after them in the file
+
+	SignatureSection unknown;
+
+	unknown.id = 0x100;
+	unknown.itemSize = 1;
+	unknown.offset = SignatureSectionLayout::alignedOffset(file.size());
+	unknown.size = 100;
+
+	sections.insert(sections.begin() + 1, unknown);
+
+	file.resize(static_cast<size_t>(unknown.offset + unknown.size), 0xEE);
+
+	auto pos = file.data() + SignatureHeaderTraits::size();
+	auto put = [&pos](const auto& field) {
+		std::memcpy(pos, &field, sizeof(field));
+		pos += sizeof(field);
+	};
+
+	put(static_cast<uint32_t>(sections.size()));
+	put(entrySize);
+
+	for (auto& section : sections) {
+		put(section.id);
+		put(section.itemSize);
+		put(section.offset);
+		put(section.size);
+	}
+
+	writeFile(output.get(), file);
+
+	SignatureFile signature{ output.get() };
+	auto digests = blockDigests(data, s_blockSize, HashFunctionId::MD5);
+
+	CHECK(signature.sections().size() == sections.size());
+	CHECK(std::equal(digests.begin(), digests.end(), signature.digests()));
+	CHECK(signature.weakChecksum(0) == RollingChecksum::compute(data.data(), s_blockSize));
+
+	FileSignatureVerifier verifier{ input.string().c_str(), output.string().c_str() };
+
+	CHECK(verifier.result().passed());
+}
+
+}
+
+// -------------------------------------------------------------------------- //
+
+std::vector<test_t> signatureFormatTests() {
+	return {
+		{ "testVersion1Default", &testVersion1Default },
+		{ "testVersion1MappedOutput", &testVersion1MappedOutput },
+		{ "testVersion2Options", &testVersion2Options },
+		{ "testSectionedNoFlags", &testSectionedNoFlags },
+		{ "testSectionTable", &testSectionTable },
+		{ "testUnknownSectionSkipped", &testUnknownSectionSkipped },
+	};
+}
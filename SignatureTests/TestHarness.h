@@ -0,0 +1,133 @@
+#pragma once
+
+#include "stdafx.h"
+#include "CpuFeatures.h"
+#include "FileSignatureCreator.h"
+#include "HashWrappers.h"
+
+#include <random>
+
+// -------------------------------------------------------------------------- //
+/*
+	the pieces shared by the tests: every source file of the project makes a list of its tests,
+	and the tests fail by throwing, most of them through CHECK
+ */
+// -------------------------------------------------------------------------- //
+
+#define CHECK(condition) \
+	if (!(condition)) { \
+		throw std::runtime_error("Check failed at " __FILE__ ":" + std::to_string(__LINE__) + ": " #condition); \
+	}
+
+using test_t = std::pair<const char*, void (*)()>;
+
+std::vector<test_t> signatureFormatTests();
+std::vector<test_t> hashKernelTests();
+std::vector<test_t> modeTests();
+
+// -------------------------------------------------------------------------- //
+
+class TempFile {
+public:
+
+	explicit TempFile (const char* name) : m_path(temp_directory_path() / name) {}
+
+	~TempFile() {
+		std::error_code stub;
+
+		remove(m_path, stub);
+	}
+
+	const path& get() const { return m_path; }
+	std::string string() const { return m_path.string(); }
+
+private:
+
+	path m_path;
+};
+
+// -------------------------------------------------------------------------- //
+
+inline std::vector<unsigned char> readFile (const path& filePath) {
+	std::ifstream ifs{ filePath, std::ios_base::in | std::ios_base::binary };
+
+	return { std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>() };
+}
+
+inline void writeFile (const path& filePath, const std::vector<unsigned char>& data) {
+	std::ofstream ofs{ filePath, std::ios_base::out | std::ios_base::binary };
+
+	ofs.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+inline std::vector<unsigned char> randomBytes (size_t size, unsigned int seed) {
+	std::vector<unsigned char> data(size);
+	std::mt19937 engine{ seed };
+
+	for (auto& byte : data) {
+		byte = static_cast<unsigned char>(engine());
+	}
+
+	return data;
+}
+
+// the digests of the blocks of the input one after another
+
+inline std::vector<unsigned char> blockDigests (const std::vector<unsigned char>& data, uint32_t blockSize, HashFunctionId id) {
+	auto hasher = HashWrapperFactory::createHashWrapper(id);
+	auto digestSize = HashTraits::digestSize(id);
+
+	std::vector<unsigned char> digests;
+
+	for (size_t offset = 0; offset < data.size(); offset += blockSize) {
+		digests.resize(digests.size() + digestSize);
+
+		hasher->createDigest(data.data() + offset, std::min<size_t>(blockSize, data.size() - offset),
+							 digests.data() + digests.size() - digestSize);
+	}
+
+	return digests;
+}
+
+// -------------------------------------------------------------------------- //
+
+inline const char* simdLevelName (SimdLevel level) {
+	switch (level) {
+	case SimdLevel::SSE2:
+		return "SSE2";
+	case SimdLevel::AVX2:
+		return "AVX2";
+	case SimdLevel::AVX512:
+		return "AVX-512";
+	default:
+		return "C++";
+	}
+}
+
+// runs the check once per instruction set the CPU supports, the plain C++ one included,
+// with the kernels limited to it; the level a check fails at is added to the message
+
+template <class Check>
+void forEachSimdLevel (Check check) {
+	struct LimitReset {
+		~LimitReset() { CpuFeatures::limitSimdLevel(SimdLevel::AVX512); }
+	} reset;
+
+	CpuFeatures::limitSimdLevel(SimdLevel::AVX512);
+
+	const auto topLevel = CpuFeatures::simdLevel();
+
+	for (auto level : { SimdLevel::None, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 }) {
+		if (level > topLevel) {
+			break;
+		}
+
+		CpuFeatures::limitSimdLevel(level);
+
+		try {
+			check(level);
+		} catch (const std::exception& e) {
+			throw std::runtime_error(std::string(e.what()) + " (" + simdLevelName(level) + ")");
+		}
+	}
+}
@@ -0,0 +1,29 @@
+#include "TestHarness.h"
+
+// -------------------------------------------------------------------------- //
+
+int main() {
+	std::vector<test_t> tests;
+
+	for (auto suite : { &signatureFormatTests, &hashKernelTests, &modeTests }) {
+		auto suiteTests = suite();
+
+		tests.insert(tests.end(), suiteTests.begin(), suiteTests.end());
+	}
+
+	int failures{ 0 };
+
+	for (auto& test : tests) {
+		try {
+			test.second();
+
+			std::cout << "Passed: " << test.first << std::endl;
+		} catch (const std::exception& e) {
+			std::cout << "FAILED: " << test.first << ": " << e.what() << std::endl;
+
+			++failures;
+		}
+	}
+
+	return failures ? 1 : 0;
+}
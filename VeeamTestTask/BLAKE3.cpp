@@ -0,0 +1,602 @@
+#include "stdafx.h"
+#include "BLAKE3.h"
+#include "Simd.h"
+
+#ifdef __GNUC__
+// the generic code passes the vectors around by value, but it never ends up
+// out of line, so the calling convention it would have is of no concern
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+// the inputs are read as little-endian words, which is what all the supported platforms are
+
+namespace {
+
+constexpr size_t s_blockSize{ 64 };
+constexpr size_t s_blocksPerChunk{ BLAKE3::s_chunkSize / s_blockSize };
+
+// the chunks are hashed in groups of this many, each group is then a subtree of its own
+
+constexpr size_t s_groupChunks{ 128 };
+constexpr unsigned int s_maxLanes{ 16 };
+
+// the domain separation flags
+
+constexpr uint32_t s_chunkStart{ 1 };
+constexpr uint32_t s_chunkEnd{ 2 };
+constexpr uint32_t s_parent{ 4 };
+constexpr uint32_t s_root{ 8 };
+
+constexpr uint32_t s_iv[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+// the order the message words are taken in by each of the seven rounds
+
+constexpr unsigned char s_schedule[7][16] = {
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+	{ 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 },
+	{ 3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1 },
+	{ 10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6 },
+	{ 12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4 },
+	{ 9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7 },
+	{ 11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13 }
+};
+
+inline uint32_t read32 (const unsigned char* p) {
+	uint32_t x;
+
+	std::memcpy(&x, p, sizeof(x));
+
+	return x;
+}
+
+inline void write32 (uint32_t x, unsigned char* p) {
+	std::memcpy(p, &x, sizeof(x));
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	ScalarLanes, SSE2Lanes, AVX2Lanes and AVX512Lanes classes
+
+	the vector operations the compression function is made of, for one, four,
+	eight and sixteen lanes; every lane compresses a block of an input of its own
+ */
+// -------------------------------------------------------------------------- //
+
+struct ScalarLanes {
+	using vec_t = uint32_t;
+
+	static constexpr unsigned int s_count{ 1 };
+
+	static vec_t set1 (uint32_t x) { return x; }
+	static vec_t load (const uint32_t* words) { return words[0]; }
+	static vec_t add (vec_t a, vec_t b) { return a + b; }
+	static vec_t xor2 (vec_t a, vec_t b) { return a ^ b; }
+
+	template <int n>
+	static vec_t ror (vec_t x) { return (x >> n) | (x << (32 - n)); }
+
+	static void loadBlock (const unsigned char* const inputs[], size_t offset, vec_t m[16]) {
+		for (int i = 0; i < 16; ++i) {
+			m[i] = read32(inputs[0] + offset + i * 4);
+		}
+	}
+
+	static void storeChainingValues (const vec_t h[8], unsigned char* out) {
+		for (int i = 0; i < 8; ++i) {
+			write32(h[i], out + i * 4);
+		}
+	}
+};
+
+#ifdef SIMD_X86
+
+struct SSE2Lanes {
+	using vec_t = __m128i;
+
+	static constexpr unsigned int s_count{ 4 };
+
+	static SIMD_TARGET_SSE2 vec_t set1 (uint32_t x) { return _mm_set1_epi32(static_cast<int>(x)); }
+	static SIMD_TARGET_SSE2 vec_t load (const uint32_t* words) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(words)); }
+	static SIMD_TARGET_SSE2 vec_t add (vec_t a, vec_t b) { return _mm_add_epi32(a, b); }
+	static SIMD_TARGET_SSE2 vec_t xor2 (vec_t a, vec_t b) { return _mm_xor_si128(a, b); }
+
+	template <int n>
+	static SIMD_TARGET_SSE2 vec_t ror (vec_t x) { return _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - n)); }
+
+	// the 16 message words of a block of every lane, one word of all the lanes per vector
+	static SIMD_TARGET_SSE2 void loadBlock (const unsigned char* const inputs[], size_t offset, vec_t m[16]) {
+		for (int quarter = 0; quarter < 4; ++quarter) {
+			for (unsigned int j = 0; j < s_count; ++j) {
+				m[quarter * 4 + j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputs[j] + offset + quarter * 16));
+			}
+
+			transpose4x4(m + quarter * 4);
+		}
+	}
+
+	// the chaining values of the lanes are put one after another
+	static SIMD_TARGET_SSE2 void storeChainingValues (const vec_t h[8], unsigned char* out) {
+		for (int half = 0; half < 2; ++half) {
+			__m128i r[4] = { h[half * 4], h[half * 4 + 1], h[half * 4 + 2], h[half * 4 + 3] };
+
+			transpose4x4(r);
+
+			for (unsigned int j = 0; j < s_count; ++j) {
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + j * BLAKE3::s_chainingValueSize + half * 16), r[j]);
+			}
+		}
+	}
+};
+
+// -------------------------------------------------------------------------- //
+
+struct AVX2Lanes {
+	using vec_t = __m256i;
+
+	static constexpr unsigned int s_count{ 8 };
+
+	static SIMD_TARGET_AVX2 vec_t set1 (uint32_t x) { return _mm256_set1_epi32(static_cast<int>(x)); }
+	static SIMD_TARGET_AVX2 vec_t load (const uint32_t* words) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words)); }
+	static SIMD_TARGET_AVX2 vec_t add (vec_t a, vec_t b) { return _mm256_add_epi32(a, b); }
+	static SIMD_TARGET_AVX2 vec_t xor2 (vec_t a, vec_t b) { return _mm256_xor_si256(a, b); }
+
+	template <int n>
+	static SIMD_TARGET_AVX2 vec_t ror (vec_t x) { return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n)); }
+
+	static SIMD_TARGET_AVX2 void loadBlock (const unsigned char* const inputs[], size_t offset, vec_t m[16]) {
+		for (int half = 0; half < 2; ++half) {
+			for (unsigned int j = 0; j < s_count; ++j) {
+				m[half * 8 + j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inputs[j] + offset + half * 32));
+			}
+
+			transpose8x8(m + half * 8);
+		}
+	}
+
+	static SIMD_TARGET_AVX2 void storeChainingValues (const vec_t h[8], unsigned char* out) {
+		__m256i r[8];
+
+		std::copy(h, h + 8, r);
+
+		transpose8x8(r);
+
+		for (unsigned int j = 0; j < s_count; ++j) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j * BLAKE3::s_chainingValueSize), r[j]);
+		}
+	}
+};
+
+// -------------------------------------------------------------------------- //
+
+struct AVX512Lanes {
+	using vec_t = __m512i;
+
+	static constexpr unsigned int s_count{ 16 };
+
+	static SIMD_TARGET_AVX512 vec_t set1 (uint32_t x) { return _mm512_set1_epi32(static_cast<int>(x)); }
+	static SIMD_TARGET_AVX512 vec_t load (const uint32_t* words) { return _mm512_loadu_si512(words); }
+	static SIMD_TARGET_AVX512 vec_t add (vec_t a, vec_t b) { return _mm512_add_epi32(a, b); }
+	static SIMD_TARGET_AVX512 vec_t xor2 (vec_t a, vec_t b) { return _mm512_xor_si512(a, b); }
+
+	template <int n>
+	static SIMD_TARGET_AVX512 vec_t ror (vec_t x) { return _mm512_ror_epi32(x, n); }
+
+	// the lanes are transposed in two groups of eight, which are then put side by side
+	static SIMD_TARGET_AVX512 void loadBlock (const unsigned char* const inputs[], size_t offset, vec_t m[16]) {
+		for (int half = 0; half < 2; ++half) {
+			__m256i lo[8], hi[8];
+
+			for (unsigned int j = 0; j < 8; ++j) {
+				lo[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inputs[j] + offset + half * 32));
+				hi[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inputs[j + 8] + offset + half * 32));
+			}
+
+			transpose8x8(lo);
+			transpose8x8(hi);
+
+			for (int i = 0; i < 8; ++i) {
+				m[half * 8 + i] = _mm512_inserti64x4(_mm512_castsi256_si512(lo[i]), hi[i], 1);
+			}
+		}
+	}
+
+	static SIMD_TARGET_AVX512 void storeChainingValues (const vec_t h[8], unsigned char* out) {
+		__m256i lo[8], hi[8];
+
+		for (int i = 0; i < 8; ++i) {
+			lo[i] = _mm512_castsi512_si256(h[i]);
+			hi[i] = _mm512_extracti64x4_epi64(h[i], 1);
+		}
+
+		transpose8x8(lo);
+		transpose8x8(hi);
+
+		for (unsigned int j = 0; j < 8; ++j) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j * BLAKE3::s_chainingValueSize), lo[j]);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + (j + 8) * BLAKE3::s_chainingValueSize), hi[j]);
+		}
+	}
+};
+
+#endif
+
+// -------------------------------------------------------------------------- //
+/*
+	Kernel class
+
+	the BLAKE3 compression function written in terms of the lane operations
+ */
+// -------------------------------------------------------------------------- //
+
+template <class Lanes>
+struct Kernel {
+	using vec_t = typename Lanes::vec_t;
+
+	static void mix (vec_t v[16], int a, int b, int c, int d, vec_t x, vec_t y) {
+		v[a] = Lanes::add(Lanes::add(v[a], v[b]), x);
+		v[d] = Lanes::template ror<16>(Lanes::xor2(v[d], v[a]));
+		v[c] = Lanes::add(v[c], v[d]);
+		v[b] = Lanes::template ror<12>(Lanes::xor2(v[b], v[c]));
+		v[a] = Lanes::add(Lanes::add(v[a], v[b]), y);
+		v[d] = Lanes::template ror<8>(Lanes::xor2(v[d], v[a]));
+		v[c] = Lanes::add(v[c], v[d]);
+		v[b] = Lanes::template ror<7>(Lanes::xor2(v[b], v[c]));
+	}
+
+	static void round (vec_t v[16], const vec_t m[16], const unsigned char s[16]) {
+		mix(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+		mix(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+		mix(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+		mix(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+		mix(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+		mix(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+		mix(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+		mix(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+	}
+
+	// the chaining value is replaced with the first half of the compression output,
+	// which is all there is to the 32-byte digest as well
+	static void compress (vec_t h[8], const vec_t m[16], vec_t counterLow, vec_t counterHigh, vec_t blockLength, vec_t flags) {
+		vec_t v[16] = {
+			h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],
+			Lanes::set1(s_iv[0]), Lanes::set1(s_iv[1]), Lanes::set1(s_iv[2]), Lanes::set1(s_iv[3]),
+			counterLow, counterHigh, blockLength, flags
+		};
+
+		round(v, m, s_schedule[0]);
+		round(v, m, s_schedule[1]);
+		round(v, m, s_schedule[2]);
+		round(v, m, s_schedule[3]);
+		round(v, m, s_schedule[4]);
+		round(v, m, s_schedule[5]);
+		round(v, m, s_schedule[6]);
+
+		for (int i = 0; i < 8; ++i) {
+			h[i] = Lanes::xor2(v[i], v[i + 8]);
+		}
+	}
+
+	// hashes an input of whole blocks per lane, the counter is either the same for all the lanes,
+	// or goes up by one from lane to lane; the first and the last blocks get the extra flags
+	static void hashMany (const unsigned char* const inputs[], size_t blocks, uint64_t counter, bool incrementCounter,
+						  uint32_t flags, uint32_t flagsStart, uint32_t flagsEnd, unsigned char* out) {
+		uint32_t counterWords[2][Lanes::s_count];
+
+		for (unsigned int j = 0; j < Lanes::s_count; ++j) {
+			auto laneCounter = counter + (incrementCounter ? j : 0);
+
+			counterWords[0][j] = static_cast<uint32_t>(laneCounter);
+			counterWords[1][j] = static_cast<uint32_t>(laneCounter >> 32);
+		}
+
+		vec_t h[8];
+
+		for (int i = 0; i < 8; ++i) {
+			h[i] = Lanes::set1(s_iv[i]);
+		}
+
+		auto counterLow = Lanes::load(counterWords[0]);
+		auto counterHigh = Lanes::load(counterWords[1]);
+		auto blockLength = Lanes::set1(static_cast<uint32_t>(s_blockSize));
+
+		for (size_t b = 0; b < blocks; ++b) {
+			vec_t m[16];
+
+			Lanes::loadBlock(inputs, b * s_blockSize, m);
+
+			auto blockFlags = flags | (b == 0 ? flagsStart : 0) | (b + 1 == blocks ? flagsEnd : 0);
+
+			compress(h, m, counterLow, counterHigh, blockLength, Lanes::set1(blockFlags));
+		}
+
+		Lanes::storeChainingValues(h, out);
+	}
+};
+
+using hash_many_fn_t = void (*)(const unsigned char* const inputs[], size_t blocks, uint64_t counter, bool incrementCounter,
+								uint32_t flags, uint32_t flagsStart, uint32_t flagsEnd, unsigned char* out);
+
+void hashManyScalar (const unsigned char* const inputs[], size_t blocks, uint64_t counter, bool incrementCounter,
+					 uint32_t flags, uint32_t flagsStart, uint32_t flagsEnd, unsigned char* out) {
+	Kernel<ScalarLanes>::hashMany(inputs, blocks, counter, incrementCounter, flags, flagsStart, flagsEnd, out);
+}
+
+#ifdef SIMD_X86
+
+SIMD_TARGET_SSE2 SIMD_ENTRY
+void hashManySSE2 (const unsigned char* const inputs[], size_t blocks, uint64_t counter, bool incrementCounter,
+				   uint32_t flags, uint32_t flagsStart, uint32_t flagsEnd, unsigned char* out) {
+	Kernel<SSE2Lanes>::hashMany(inputs, blocks, counter, incrementCounter, flags, flagsStart, flagsEnd, out);
+}
+
+SIMD_TARGET_AVX2 SIMD_ENTRY
+void hashManyAVX2 (const unsigned char* const inputs[], size_t blocks, uint64_t counter, bool incrementCounter,
+				   uint32_t flags, uint32_t flagsStart, uint32_t flagsEnd, unsigned char* out) {
+	Kernel<AVX2Lanes>::hashMany(inputs, blocks, counter, incrementCounter, flags, flagsStart, flagsEnd, out);
+}
+
+SIMD_TARGET_AVX512 SIMD_ENTRY
+void hashManyAVX512 (const unsigned char* const inputs[], size_t blocks, uint64_t counter, bool incrementCounter,
+					 uint32_t flags, uint32_t flagsStart, uint32_t flagsEnd, unsigned char* out) {
+	Kernel<AVX512Lanes>::hashMany(inputs, blocks, counter, incrementCounter, flags, flagsStart, flagsEnd, out);
+}
+
+#endif
+
+struct ManyKernel {
+	hash_many_fn_t hashMany;
+	unsigned int lanes;
+};
+
+const SimdKernel<ManyKernel> s_manyKernels[] = {
+#ifdef SIMD_X86
+	{ SimdLevel::AVX512, { &hashManyAVX512, AVX512Lanes::s_count }, "AVX-512" },
+	{ SimdLevel::AVX2, { &hashManyAVX2, AVX2Lanes::s_count }, "AVX2" },
+	{ SimdLevel::SSE2, { &hashManySSE2, SSE2Lanes::s_count }, "SSE2" },
+#endif
+	{ SimdLevel::None, { &hashManyScalar, ScalarLanes::s_count }, "C++" }
+};
+
+// runs the inputs lying `stride` bytes apart through the kernel, as many at a time as it has lanes,
+// the spare lanes of the last round just repeat the last input, and their results are thrown away;
+// the results may overwrite the inputs they are made of
+
+void hashStrided (const unsigned char* input, size_t stride, size_t count, size_t blocks, uint64_t counter, bool incrementCounter,
+				  uint32_t flags, uint32_t flagsStart, uint32_t flagsEnd, unsigned char* out) {
+	const auto& kernel = selectKernel(s_manyKernels).fn;
+
+	for (size_t i = 0; i < count; i += kernel.lanes) {
+		auto n = std::min<size_t>(kernel.lanes, count - i);
+
+		const unsigned char* inputs[s_maxLanes];
+
+		for (unsigned int j = 0; j < kernel.lanes; ++j) {
+			inputs[j] = input + (i + std::min<size_t>(j, n - 1)) * stride;
+		}
+
+		auto laneCounter = counter + (incrementCounter ? i : 0);
+
+		if (n == kernel.lanes) {
+			kernel.hashMany(inputs, blocks, laneCounter, incrementCounter, flags, flagsStart, flagsEnd,
+							out + i * BLAKE3::s_chainingValueSize);
+		} else {
+			unsigned char spare[s_maxLanes * BLAKE3::s_chainingValueSize];
+
+			kernel.hashMany(inputs, blocks, laneCounter, incrementCounter, flags, flagsStart, flagsEnd, spare);
+
+			std::memcpy(out + i * BLAKE3::s_chainingValueSize, spare, n * BLAKE3::s_chainingValueSize);
+		}
+	}
+}
+
+// compresses a single block of up to 64 bytes
+
+void compressBlock (uint32_t h[8], const unsigned char* block, size_t size, uint64_t counter, uint32_t flags) {
+	unsigned char padded[s_blockSize] = {};
+
+	if (size) {
+		std::memcpy(padded, block, size);
+	}
+
+	const unsigned char* inputs[1] = { padded };
+	uint32_t m[16];
+
+	ScalarLanes::loadBlock(inputs, 0, m);
+
+	Kernel<ScalarLanes>::compress(h, m, static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32),
+								  static_cast<uint32_t>(size), flags);
+}
+
+// the chaining value of a chunk shorter than the others, or the digest of an input of a single chunk
+
+void chunkOutput (const unsigned char* input, size_t size, uint64_t counter, uint32_t flags, unsigned char* out) {
+	uint32_t h[8];
+
+	std::copy(s_iv, s_iv + 8, h);
+
+	auto blocks = std::max<size_t>((size + s_blockSize - 1) / s_blockSize, 1);
+
+	for (size_t b = 0; b < blocks; ++b) {
+		auto blockFlags = (b == 0 ? s_chunkStart : 0) | (b + 1 == blocks ? s_chunkEnd | flags : 0);
+
+		compressBlock(h, input + b * s_blockSize, std::min(s_blockSize, size - b * s_blockSize), counter, blockFlags);
+	}
+
+	ScalarLanes::storeChainingValues(h, out);
+}
+
+void parentOutput (const unsigned char* left, const unsigned char* right, uint32_t flags, unsigned char* out) {
+	unsigned char block[s_blockSize];
+
+	std::memcpy(block, left, BLAKE3::s_chainingValueSize);
+	std::memcpy(block + BLAKE3::s_chainingValueSize, right, BLAKE3::s_chainingValueSize);
+
+	uint32_t h[8];
+
+	std::copy(s_iv, s_iv + 8, h);
+
+	compressBlock(h, block, s_blockSize, 0, s_parent | flags);
+
+	ScalarLanes::storeChainingValues(h, out);
+}
+
+// the chaining values of the chunks of a group, the last one of them may be partial
+
+size_t groupChainingValues (const unsigned char* input, size_t size, uint64_t firstChunk, unsigned char* out) {
+	auto wholeChunks = size / BLAKE3::s_chunkSize;
+	auto rest = size % BLAKE3::s_chunkSize;
+
+	hashStrided(input, BLAKE3::s_chunkSize, wholeChunks, s_blocksPerChunk, firstChunk, true, 0, s_chunkStart, s_chunkEnd, out);
+
+	if (rest) {
+		chunkOutput(input + wholeChunks * BLAKE3::s_chunkSize, rest, firstChunk + wholeChunks, 0,
+					out + wholeChunks * BLAKE3::s_chainingValueSize);
+	}
+
+	return wholeChunks + (rest > 0);
+}
+
+// pairs up the neighbouring chaining values level by level, the odd one out is moved up a level as it is,
+// which is exactly how the tree is shaped; stops once there are no more than `target` values left
+
+size_t reduceChainingValues (unsigned char* cvs, size_t count, size_t target) {
+	while (count > target) {
+		auto pairs = count / 2;
+
+		hashStrided(cvs, 2 * BLAKE3::s_chainingValueSize, pairs, 1, 0, false, s_parent, 0, 0, cvs);
+
+		if (count % 2) {
+			std::memcpy(cvs + pairs * BLAKE3::s_chainingValueSize, cvs + (count - 1) * BLAKE3::s_chainingValueSize,
+						BLAKE3::s_chainingValueSize);
+		}
+
+		count = pairs + count % 2;
+	}
+
+	return count;
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	ChainingValueStack class
+
+	merges the chaining values of the subtrees of the same size coming from left to right,
+	a pair of the subtrees is merged as soon as one more comes after them, which keeps
+	the last one unmerged until it's known whether it's the root's child
+ */
+// -------------------------------------------------------------------------- //
+
+class ChainingValueStack {
+public:
+
+	void push (const unsigned char* cv, bool last) {
+		std::memcpy(m_cvs[m_depth++], cv, BLAKE3::s_chainingValueSize);
+
+		// the completed subtrees are merged according to the trailing zero bits of their total count
+
+		if (!last) {
+			for (auto n = ++m_pushed; (n & 1) == 0; n >>= 1) {
+				merge();
+			}
+		}
+	}
+
+	// merges what's left from right to left, the flags go to the topmost node
+	void finish (uint32_t flags, unsigned char* out) {
+		assert(m_depth >= 2);
+
+		while (m_depth > 2) {
+			merge();
+		}
+
+		parentOutput(m_cvs[0], m_cvs[1], flags, out);
+	}
+
+private:
+
+	void merge () {
+		parentOutput(m_cvs[m_depth - 2], m_cvs[m_depth - 1], 0, m_cvs[m_depth - 2]);
+
+		--m_depth;
+	}
+
+private:
+
+	unsigned char m_cvs[64][BLAKE3::s_chainingValueSize];
+	size_t m_depth{ 0 };
+	uint64_t m_pushed{ 0 };
+};
+
+// the chaining value of the subtree made of the chunks of the input, or the digest if it's the root
+
+void subtreeOutput (const unsigned char* input, size_t size, uint64_t firstChunk, uint32_t flags, unsigned char* out) {
+	if (size <= BLAKE3::s_chunkSize) {
+		chunkOutput(input, size, firstChunk, flags, out);
+
+		return;
+	}
+
+	unsigned char cvs[s_groupChunks * BLAKE3::s_chainingValueSize];
+	const auto groupSize = s_groupChunks * BLAKE3::s_chunkSize;
+
+	if (size <= groupSize) {
+		reduceChainingValues(cvs, groupChainingValues(input, size, firstChunk, cvs), 2);
+
+		parentOutput(cvs, cvs + BLAKE3::s_chainingValueSize, flags, out);
+
+		return;
+	}
+
+	ChainingValueStack stack;
+
+	for (size_t offset = 0; offset < size; offset += groupSize) {
+		auto count = groupChainingValues(input + offset, std::min(groupSize, size - offset),
+										 firstChunk + offset / BLAKE3::s_chunkSize, cvs);
+
+		reduceChainingValues(cvs, count, 1);
+
+		stack.push(cvs, offset + groupSize >= size);
+	}
+
+	stack.finish(flags, out);
+}
+
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	BLAKE3 methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+void BLAKE3::hash (const unsigned char* input, size_t size, unsigned char* digest) {
+	subtreeOutput(input, size, 0, s_root, digest);
+}
+
+// -------------------------------------------------------------------------- //
+
+void BLAKE3::hashPart (const unsigned char* part, size_t size, uint64_t firstChunk, unsigned char* chainingValue) {
+	assert(size > 0);
+
+	subtreeOutput(part, size, firstChunk, 0, chainingValue);
+}
+
+// -------------------------------------------------------------------------- //
+
+void BLAKE3::combineParts (const unsigned char* chainingValues, size_t count, unsigned char* digest) {
+	ChainingValueStack stack;
+
+	for (size_t i = 0; i < count; ++i) {
+		stack.push(chainingValues + i * s_chainingValueSize, i + 1 == count);
+	}
+
+	stack.finish(s_root, digest);
+}
+
+// -------------------------------------------------------------------------- //
+
+const char* BLAKE3::kernelName() {
+	return selectKernel(s_manyKernels).name;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// -------------------------------------------------------------------------- //
+/*
+	BLAKE3 class
+
+	the BLAKE3 hash function with the default 32-byte output and no key
+
+	the input is cut into 1 KB chunks, which are the leaves of a binary tree of chaining
+	values; the chunks, as well as the parent nodes of each level, are independent of each
+	other and are hashed several at a time, one per vector lane
+
+	a long input may also be hashed in parts, each one of them a subtree of its own,
+	and the digest is then obtained from the chaining values of the parts
+ */
+// -------------------------------------------------------------------------- //
+
+class BLAKE3 {
+public:
+
+	static constexpr unsigned int s_digestSize{ 32 };
+	static constexpr unsigned int s_chainingValueSize{ 32 };
+	static constexpr size_t s_chunkSize{ 1024 };
+
+	static void hash (const unsigned char* input, size_t size, unsigned char* digest);
+
+	// the chaining value of a part of the input starting at the given chunk, the part is
+	// a power-of-two number of chunks long, except for the last part of the input
+	static void hashPart (const unsigned char* part, size_t size, uint64_t firstChunk, unsigned char* chainingValue);
+
+	// the digest of an input made of at least two parts of the same size, out of their chaining values
+	static void combineParts (const unsigned char* chainingValues, size_t count, unsigned char* digest);
+
+	static const char* kernelName();
+};
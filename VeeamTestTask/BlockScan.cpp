@@ -0,0 +1,179 @@
+#include "stdafx.h"
+#include "BlockScan.h"
+#include "Simd.h"
+
+namespace {
+
+// the places the first word of the block recurs at are checked against the block
+// no more times than that, the ordinary data seldom gets past the first of them
+
+constexpr unsigned int s_maxPeriodChecks{ 4 };
+
+// -------------------------------------------------------------------------- //
+/*
+	the strides of a block checked at a time, whatever is left after the last
+	whole stride is checked byte by byte
+ */
+// -------------------------------------------------------------------------- //
+
+struct ScalarStride {
+	static constexpr size_t s_size{ 32 };
+
+	static bool isZero (const unsigned char* data) {
+		uint64_t words[4];
+
+		std::memcpy(words, data, sizeof(words));
+
+		return !(words[0] | words[1] | words[2] | words[3]);
+	}
+};
+
+#ifdef SIMD_X86
+
+struct SSE2Stride {
+	static constexpr size_t s_size{ 64 };
+
+	static SIMD_TARGET_SSE2 bool isZero (const unsigned char* data) {
+		auto p = reinterpret_cast<const __m128i*>(data);
+
+		auto any = _mm_or_si128(_mm_or_si128(_mm_loadu_si128(p), _mm_loadu_si128(p + 1)),
+								_mm_or_si128(_mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3)));
+
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(any, _mm_setzero_si128())) == 0xFFFF;
+	}
+};
+
+// -------------------------------------------------------------------------- //
+
+struct AVX2Stride {
+	static constexpr size_t s_size{ 128 };
+
+	static SIMD_TARGET_AVX2 bool isZero (const unsigned char* data) {
+		auto p = reinterpret_cast<const __m256i*>(data);
+
+		auto any = _mm256_or_si256(_mm256_or_si256(_mm256_loadu_si256(p), _mm256_loadu_si256(p + 1)),
+								   _mm256_or_si256(_mm256_loadu_si256(p + 2), _mm256_loadu_si256(p + 3)));
+
+		return _mm256_testz_si256(any, any) != 0;
+	}
+};
+
+// -------------------------------------------------------------------------- //
+
+struct AVX512Stride {
+	static constexpr size_t s_size{ 256 };
+
+	static SIMD_TARGET_AVX512 bool isZero (const unsigned char* data) {
+		auto any = _mm512_or_si512(_mm512_or_si512(_mm512_loadu_si512(data), _mm512_loadu_si512(data + 64)),
+								   _mm512_or_si512(_mm512_loadu_si512(data + 128), _mm512_loadu_si512(data + 192)));
+
+		return !_mm512_test_epi64_mask(any, any);
+	}
+};
+
+#endif
+
+template <class Stride>
+bool isZero (const unsigned char* data, size_t size) {
+	size_t offset{ 0 };
+
+	for (; offset + Stride::s_size <= size; offset += Stride::s_size) {
+		if (!Stride::isZero(data + offset)) {
+			return false;
+		}
+	}
+
+	for (; offset < size; ++offset) {
+		if (data[offset]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+using is_zero_fn_t = bool (*)(const unsigned char* data, size_t size);
+
+bool isZeroScalar (const unsigned char* data, size_t size) {
+	return isZero<ScalarStride>(data, size);
+}
+
+#ifdef SIMD_X86
+
+SIMD_TARGET_SSE2 SIMD_ENTRY
+bool isZeroSSE2 (const unsigned char* data, size_t size) {
+	return isZero<SSE2Stride>(data, size);
+}
+
+SIMD_TARGET_AVX2 SIMD_ENTRY
+bool isZeroAVX2 (const unsigned char* data, size_t size) {
+	return isZero<AVX2Stride>(data, size);
+}
+
+SIMD_TARGET_AVX512 SIMD_ENTRY
+bool isZeroAVX512 (const unsigned char* data, size_t size) {
+	return isZero<AVX512Stride>(data, size);
+}
+
+#endif
+
+const SimdKernel<is_zero_fn_t> s_scanKernels[] = {
+#ifdef SIMD_X86
+	{ SimdLevel::AVX512, &isZeroAVX512, "AVX-512" },
+	{ SimdLevel::AVX2, &isZeroAVX2, "AVX2" },
+	{ SimdLevel::SSE2, &isZeroSSE2, "SSE2" },
+#endif
+	{ SimdLevel::None, &isZeroScalar, "C++" }
+};
+
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	BlockScan methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+bool BlockScan::isZero (const unsigned char* data, size_t size) {
+	return selectKernel(s_scanKernels).fn(data, size);
+}
+
+// -------------------------------------------------------------------------- //
+
+size_t BlockScan::findPeriod (const unsigned char* data, size_t size, size_t maxPeriod) {
+	uint64_t head, word;
+
+	if (size < 2 * sizeof(head)) {
+		return 0;
+	}
+
+	std::memcpy(&head, data, sizeof(head));
+
+	maxPeriod = std::min(maxPeriod, size / 2);
+
+	unsigned int checks{ 0 };
+
+	// the shortest period is the first place the block matches itself at when shifted
+
+	for (size_t period = 1; period <= maxPeriod && checks < s_maxPeriodChecks; ++period) {
+		std::memcpy(&word, data + period, sizeof(word));
+
+		if (word != head) {
+			continue;
+		}
+
+		if (!std::memcmp(data, data + period, size - period)) {
+			return period;
+		}
+
+		++checks;
+	}
+
+	return 0;
+}
+
+// -------------------------------------------------------------------------- //
+
+const char* BlockScan::kernelName() {
+	return selectKernel(s_scanKernels).name;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+
+// -------------------------------------------------------------------------- //
+/*
+	BlockScan class
+
+	tells the blocks of a uniform content apart from the rest, so that they may get
+	a digest computed once instead of being hashed; the scan bails out at the first stride
+	that doesn't fit, which makes it next to free for the ordinary data
+
+	the blocks are checked for zeros a vector register at a time, the periods are looked for among the places the first word of the block recurs at
+	within the maximum period, and only a few of them are checked against the whole block
+ */
+// -------------------------------------------------------------------------- //
+
+class BlockScan {
+public:
+
+	static bool isZero (const unsigned char* data, size_t size);
+
+	// the shortest period the block is made of, if it's no longer than maxPeriod and
+	// repeats at least twice, or zero otherwise; may miss the period of a block made to fool it
+	static size_t findPeriod (const unsigned char* data, size_t size, size_t maxPeriod);
+
+	static const char* kernelName();
+};
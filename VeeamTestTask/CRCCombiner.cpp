@@ -0,0 +1,58 @@
+#include "stdafx.h"
+#include "CRCCombiner.h"
+
+// in the reflected bit order the most significant bit stands for x^0
+
+namespace {
+
+constexpr uint32_t s_one{ 0x80000000 };
+
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	CRCCombiner methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+CRCCombiner::CRCCombiner (uint32_t polynomial) : m_polynomial{ polynomial } {
+	auto power = s_one >> 1;
+
+	for (auto& p : m_powers) {
+		p = power;
+		power = multiply(power, power);
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+uint32_t CRCCombiner::combine (uint32_t crc1, uint32_t crc2, uint64_t length2) const {
+	// x^(8 * length2) is made of the powers x^(2^n) for the bits set in the length in bits
+
+	auto shift = s_one;
+	unsigned int n = 3;
+
+	for (auto bits = length2; bits; bits >>= 1, ++n) {
+		if (bits & 1) {
+			shift = multiply(m_powers[n], shift);
+		}
+	}
+
+	return multiply(shift, crc1) ^ crc2;
+}
+
+// -------------------------------------------------------------------------- //
+
+uint32_t CRCCombiner::multiply (uint32_t a, uint32_t b) const {
+	uint32_t product{ 0 };
+
+	for (auto bit = s_one; bit; bit >>= 1) {
+		if (a & bit) {
+			product ^= b;
+		}
+
+		b = b & 1 ? (b >> 1) ^ m_polynomial : b >> 1;
+	}
+
+	return product;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+// -------------------------------------------------------------------------- //
+/*
+	CRCCombiner class
+
+	computes the CRC of two messages put together out of their own CRCs and the length
+	of the second one, without going through the data again: the CRC of the first one
+	is multiplied by x to the power of the second one's length in bits modulo the polynomial
+
+	the powers of x needed for that are squared from a table of x^(2^n), so a combination
+	takes a number of carry-less multiplications logarithmic in the length
+
+	meant for the reflected 32-bit CRCs with the initial value and the final XOR of all ones,
+	the CRC32 and CRC32C ones among them
+ */
+// -------------------------------------------------------------------------- //
+
+class CRCCombiner {
+public:
+
+	// the polynomials in the reflected bit order
+	static constexpr uint32_t s_crc32Polynomial{ 0xEDB88320 };
+	static constexpr uint32_t s_crc32cPolynomial{ 0x82F63B78 };
+
+	explicit CRCCombiner (uint32_t polynomial);
+
+	uint32_t combine (uint32_t crc1, uint32_t crc2, uint64_t length2) const;
+
+private:
+
+	uint32_t multiply (uint32_t a, uint32_t b) const;
+
+	uint32_t m_polynomial;
+
+	// x^(2^n) modulo the polynomial, enough of them for any length in bytes
+	uint32_t m_powers[64 + 3];
+};
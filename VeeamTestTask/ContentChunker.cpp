@@ -0,0 +1,312 @@
+#include "stdafx.h"
+#include "ContentChunker.h"
+#include "Simd.h"
+
+namespace {
+
+// the hash is 32 bits wide, every byte is shifted out of it after that many more
+
+constexpr size_t s_windowSize{ 32 };
+
+// the random values the bytes are mapped to, they are a part of the signature format
+// and must never change: the bytes offset by a fixed seed and put through a 32-bit integer mixer
+// (lowbias32 by C. Wellons), which the vector code computes in place of looking them up
+
+constexpr uint32_t s_gearSeed{ 0x56534947 };
+constexpr uint32_t s_gearMultipliers[2]{ 0x7FEB352D, 0x846CA68B };
+
+uint32_t gearValue (uint32_t byte) {
+	auto x = byte + s_gearSeed;
+
+	x ^= x >> 16;
+	x *= s_gearMultipliers[0];
+	x ^= x >> 15;
+	x *= s_gearMultipliers[1];
+	x ^= x >> 16;
+
+	return x;
+}
+
+const uint32_t* gearTable() {
+	static uint32_t s_table[256];
+	static const bool s_filled = []() {
+		for (uint32_t byte = 0; byte < 256; ++byte) {
+			s_table[byte] = gearValue(byte);
+		}
+
+		return true;
+	}();
+
+	(void)s_filled;
+
+	return s_table;
+}
+
+// the first place in [begin, end) where the hash of the window ending there matches the mask,
+// or end if there's none; the window before begin must be readable
+
+size_t findCutScalar (const unsigned char* data, size_t begin, size_t end, uint32_t mask) {
+	auto gear = gearTable();
+	uint32_t hash{ 0 };
+
+	for (auto offset = begin - s_windowSize; offset < begin; ++offset) {
+		hash = (hash << 1) + gear[data[offset]];
+	}
+
+	for (auto offset = begin; offset < end; ++offset) {
+		hash = (hash << 1) + gear[data[offset]];
+
+		if (!(hash & mask)) {
+			return offset;
+		}
+	}
+
+	return end;
+}
+
+size_t lowestBit (unsigned int bits) {
+	size_t bit{ 0 };
+
+	for (; !(bits & 1); bits >>= 1) {
+		++bit;
+	}
+
+	return bit;
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	the lanes hashing a block of places at a time: the Gear values of the block and of the window
+	before it are computed all at once, and the hash of the window ending at every place,
+	the sum of the values of its bytes shifted by their distance from its end, is folded out
+	of them in five steps, each one adding up the sums over two adjacent windows half as long,
+	the earlier one shifted by its length; the arrays start with the zeros the first steps
+	take in place of the data before the window
+ */
+// -------------------------------------------------------------------------- //
+
+constexpr size_t s_blockSize{ 256 };
+constexpr size_t s_padding{ 32 };
+constexpr size_t s_arraySize{ s_padding + s_windowSize + s_blockSize };
+
+#ifdef SIMD_X86
+
+struct AVX2Lanes {
+	static constexpr size_t s_count{ 8 };
+
+	static SIMD_TARGET_AVX2 void gearValues (const unsigned char* data, uint32_t* values) {
+		auto seed = _mm256_set1_epi32(static_cast<int>(s_gearSeed));
+		auto multiplier0 = _mm256_set1_epi32(static_cast<int>(s_gearMultipliers[0]));
+		auto multiplier1 = _mm256_set1_epi32(static_cast<int>(s_gearMultipliers[1]));
+
+		for (size_t i = 0; i < s_windowSize + s_blockSize; i += s_count) {
+			auto x = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + i))), seed);
+
+			x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+			x = _mm256_mullo_epi32(x, multiplier0);
+			x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+			x = _mm256_mullo_epi32(x, multiplier1);
+			x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+
+			_mm256_store_si256(reinterpret_cast<__m256i*>(values + s_padding + i), x);
+		}
+	}
+
+	static SIMD_TARGET_AVX2 void fold (const uint32_t* sums, uint32_t* folded, int length) {
+		auto shift = _mm_cvtsi32_si128(length);
+
+		for (size_t i = s_padding; i < s_arraySize; i += s_count) {
+			auto current = _mm256_load_si256(reinterpret_cast<const __m256i*>(sums + i));
+			auto previous = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sums + i - length));
+
+			_mm256_store_si256(reinterpret_cast<__m256i*>(folded + i), _mm256_add_epi32(current, _mm256_sll_epi32(previous, shift)));
+		}
+	}
+
+	static SIMD_TARGET_AVX2 size_t findMatch (const uint32_t* hashes, uint32_t mask) {
+		auto masks = _mm256_set1_epi32(static_cast<int>(mask));
+
+		for (size_t i = 0; i < s_blockSize; i += s_count) {
+			auto h = _mm256_load_si256(reinterpret_cast<const __m256i*>(hashes + i));
+			auto zeros = _mm256_cmpeq_epi32(_mm256_and_si256(h, masks), _mm256_setzero_si256());
+
+			if (auto bits = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(zeros)))) {
+				return i + lowestBit(bits);
+			}
+		}
+
+		return s_blockSize;
+	}
+};
+
+// -------------------------------------------------------------------------- //
+
+struct AVX512Lanes {
+	static constexpr size_t s_count{ 16 };
+
+	static SIMD_TARGET_AVX512 void gearValues (const unsigned char* data, uint32_t* values) {
+		auto seed = _mm512_set1_epi32(static_cast<int>(s_gearSeed));
+		auto multiplier0 = _mm512_set1_epi32(static_cast<int>(s_gearMultipliers[0]));
+		auto multiplier1 = _mm512_set1_epi32(static_cast<int>(s_gearMultipliers[1]));
+
+		for (size_t i = 0; i < s_windowSize + s_blockSize; i += s_count) {
+			auto x = _mm512_add_epi32(_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i))), seed);
+
+			x = _mm512_xor_si512(x, _mm512_srli_epi32(x, 16));
+			x = _mm512_mullo_epi32(x, multiplier0);
+			x = _mm512_xor_si512(x, _mm512_srli_epi32(x, 15));
+			x = _mm512_mullo_epi32(x, multiplier1);
+			x = _mm512_xor_si512(x, _mm512_srli_epi32(x, 16));
+
+			_mm512_store_si512(values + s_padding + i, x);
+		}
+	}
+
+	static SIMD_TARGET_AVX512 void fold (const uint32_t* sums, uint32_t* folded, int length) {
+		auto shift = _mm_cvtsi32_si128(length);
+
+		for (size_t i = s_padding; i < s_arraySize; i += s_count) {
+			auto current = _mm512_load_si512(sums + i);
+			auto previous = _mm512_loadu_si512(sums + i - length);
+
+			_mm512_store_si512(folded + i, _mm512_add_epi32(current, _mm512_sll_epi32(previous, shift)));
+		}
+	}
+
+	static SIMD_TARGET_AVX512 size_t findMatch (const uint32_t* hashes, uint32_t mask) {
+		auto masks = _mm512_set1_epi32(static_cast<int>(mask));
+
+		for (size_t i = 0; i < s_blockSize; i += s_count) {
+			if (auto bits = static_cast<unsigned int>(_mm512_testn_epi32_mask(_mm512_load_si512(hashes + i), masks))) {
+				return i + lowestBit(bits);
+			}
+		}
+
+		return s_blockSize;
+	}
+};
+
+#endif
+
+// the range is hashed a block at a time, whatever is left after the last whole block
+// is hashed a byte at a time
+
+template <class Lanes>
+size_t findCut (const unsigned char* data, size_t begin, size_t end, uint32_t mask) {
+	alignas(64) uint32_t sums[s_arraySize];
+	alignas(64) uint32_t folded[s_arraySize];
+
+	std::fill(sums, sums + s_padding, 0);
+	std::fill(folded, folded + s_padding, 0);
+
+	for (; begin + s_blockSize <= end; begin += s_blockSize) {
+		Lanes::gearValues(data + begin - s_windowSize, sums);
+
+		Lanes::fold(sums, folded, 1);
+		Lanes::fold(folded, sums, 2);
+		Lanes::fold(sums, folded, 4);
+		Lanes::fold(folded, sums, 8);
+		Lanes::fold(sums, folded, 16);
+
+		auto match = Lanes::findMatch(folded + s_padding + s_windowSize, mask);
+
+		if (match < s_blockSize) {
+			return begin + match;
+		}
+	}
+
+	return findCutScalar(data, begin, end, mask);
+}
+
+using find_cut_fn_t = size_t (*)(const unsigned char* data, size_t begin, size_t end, uint32_t mask);
+
+#ifdef SIMD_X86
+
+SIMD_TARGET_AVX2 SIMD_ENTRY
+size_t findCutAVX2 (const unsigned char* data, size_t begin, size_t end, uint32_t mask) {
+	return findCut<AVX2Lanes>(data, begin, end, mask);
+}
+
+SIMD_TARGET_AVX512 SIMD_ENTRY
+size_t findCutAVX512 (const unsigned char* data, size_t begin, size_t end, uint32_t mask) {
+	return findCut<AVX512Lanes>(data, begin, end, mask);
+}
+
+#endif
+
+// there are no 32-bit multiplications before SSE4.1, and the table lookups do as well as anything then
+
+const SimdKernel<find_cut_fn_t> s_chunkerKernels[] = {
+#ifdef SIMD_X86
+	{ SimdLevel::AVX512, &findCutAVX512, "AVX-512" },
+	{ SimdLevel::AVX2, &findCutAVX2, "AVX2" },
+#endif
+	{ SimdLevel::None, &findCutScalar, "C++" }
+};
+
+// the mask of the given number of the upper bits, which depend on the most of the window
+
+uint32_t upperBits (unsigned int count) {
+	return ~uint32_t{ 0 } << (32 - count);
+}
+
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	ContentChunker methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+ContentChunker::ContentChunker (uint32_t minSize, uint32_t averageSize, uint32_t maxSize) :
+	m_minSize{ minSize },
+	m_averageSize{ averageSize },
+	m_maxSize{ maxSize }
+{
+	if (minSize < s_minChunkSize || minSize > averageSize || averageSize > maxSize) {
+		throw std::invalid_argument("Wrong chunk sizes");
+	}
+
+	if (averageSize & (averageSize - 1)) {
+		throw std::invalid_argument("Average chunk size is not a power of two");
+	}
+
+	unsigned int bits{ 0 };
+
+	while ((1u << bits) < averageSize) {
+		++bits;
+	}
+
+	// two bits more and two bits less than the average size calls for, as FastCDC does it
+
+	m_strictMask = upperBits(std::min(bits + 2, 32u));
+	m_looseMask = upperBits(bits - 2);
+}
+
+// -------------------------------------------------------------------------- //
+
+size_t ContentChunker::nextChunk (const unsigned char* data, size_t size) const {
+	if (size <= m_minSize) {
+		return size;
+	}
+
+	// a chunk of n bytes is cut if the hash of the window ending at its last byte matches the mask
+
+	auto end = std::min<size_t>(size, m_maxSize);
+	auto average = std::min<size_t>(end, m_averageSize);
+	auto findCut = selectKernel(s_chunkerKernels).fn;
+
+	auto cut = findCut(data, m_minSize - 1, average - 1, m_strictMask);
+
+	if (cut == average - 1) {
+		cut = findCut(data, average - 1, end - 1, m_looseMask);
+	}
+
+	return cut + 1;
+}
+
+// -------------------------------------------------------------------------- //
+
+const char* ContentChunker::kernelName() {
+	return selectKernel(s_chunkerKernels).name;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// -------------------------------------------------------------------------- //
+/*
+	ContentChunker class
+
+	cuts the data into chunks of variable size at the places its content tells, FastCDC-style,
+	so that the data inserted into or removed from a file only changes the chunks around it
+
+	the Gear hash of the last 32 bytes is rolled along the data, and a chunk ends where the upper
+	bits of the hash are all zeros: the chunks shorter than the average need more of them than
+	the longer ones do, which keeps the chunk sizes close to the average; no chunk is cut
+	before its minimum size, and every chunk is cut at its maximum size
+
+	the hash depends on nothing but the window, so the hashes of a block of places are computed
+	all at once, one per vector lane, rather than rolled from one place to the next
+
+	may throw:
+	- std::invalid_argument - in case the chunk sizes are out of order, the minimum one is less than
+							  s_minChunkSize or the average one is not a power of two
+ */
+// -------------------------------------------------------------------------- //
+
+class ContentChunker {
+public:
+
+	static constexpr uint32_t s_minChunkSize{ 64 };
+
+	ContentChunker (uint32_t minSize, uint32_t averageSize, uint32_t maxSize);
+
+	// the size of the chunk the data starts with, the data may only end where the input does,
+	// otherwise it must be at least the maximum chunk size long
+
+	size_t nextChunk (const unsigned char* data, size_t size) const;
+
+	uint32_t minSize() const { return m_minSize; }
+	uint32_t averageSize() const { return m_averageSize; }
+	uint32_t maxSize() const { return m_maxSize; }
+
+	static const char* kernelName();
+
+private:
+
+	uint32_t m_minSize;
+	uint32_t m_averageSize;
+	uint32_t m_maxSize;
+
+	uint32_t m_strictMask{ 0 };
+	uint32_t m_looseMask{ 0 };
+};
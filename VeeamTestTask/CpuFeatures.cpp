@@ -0,0 +1,143 @@
+#include "stdafx.h"
+#include "CpuFeatures.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_FEATURES_X86 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace {
+
+struct FeatureSet {
+	bool sse2{ false };
+	bool avx2{ false };
+	bool avx512{ false };
+};
+
+#ifdef CPU_FEATURES_X86
+
+void cpuid (unsigned int leaf, unsigned int subleaf, unsigned int regs[4]) {
+#ifdef _MSC_VER
+	int r[4];
+
+	__cpuidex(r, static_cast<int>(leaf), static_cast<int>(subleaf));
+
+	for (int i = 0; i < 4; ++i) {
+		regs[i] = static_cast<unsigned int>(r[i]);
+	}
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+unsigned long long xgetbv() {
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+
+	__asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+
+	return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+
+FeatureSet detect() {
+	FeatureSet features;
+	unsigned int regs[4];
+
+	cpuid(0, 0, regs);
+
+	auto maxLeaf = regs[0];
+
+	if (maxLeaf < 1) {
+		return features;
+	}
+
+	cpuid(1, 0, regs);
+
+	features.sse2 = (regs[3] & (1u << 26)) != 0;
+
+	// the OS must have enabled saving the extended state with XSAVE
+	const bool osxsave = (regs[2] & (1u << 27)) != 0;
+	const bool avx = (regs[2] & (1u << 28)) != 0;
+
+	if (maxLeaf < 7 || !osxsave || !avx) {
+		return features;
+	}
+
+	auto xcr0 = xgetbv();
+
+	// the XMM and YMM state, then the opmask and both halves of the ZMM state
+	const bool ymmEnabled = (xcr0 & 0x06) == 0x06;
+	const bool zmmEnabled = (xcr0 & 0xE6) == 0xE6;
+
+	cpuid(7, 0, regs);
+
+	features.avx2 = ymmEnabled && (regs[1] & (1u << 5));
+	features.avx512 = zmmEnabled && (regs[1] & (1u << 16)) && (regs[1] & (1u << 30));
+
+	return features;
+}
+
+#else
+
+FeatureSet detect() { return FeatureSet{}; }
+
+#endif
+
+const FeatureSet& features() {
+	static const FeatureSet s_features = detect();
+
+	return s_features;
+}
+
+SimdLevel detectedLevel() {
+	static const SimdLevel s_level = features().avx512 ? SimdLevel::AVX512 :
+									 features().avx2 ? SimdLevel::AVX2 :
+									 features().sse2 ? SimdLevel::SSE2 : SimdLevel::None;
+
+	return s_level;
+}
+
+std::atomic<SimdLevel> s_levelLimit{ SimdLevel::AVX512 };
+
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	CpuFeatures methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+bool CpuFeatures::hasSSE2() {
+	return simdLevel() >= SimdLevel::SSE2;
+}
+
+// -------------------------------------------------------------------------- //
+
+bool CpuFeatures::hasAVX2() {
+	return simdLevel() >= SimdLevel::AVX2;
+}
+
+// -------------------------------------------------------------------------- //
+
+bool CpuFeatures::hasAVX512() {
+	return simdLevel() >= SimdLevel::AVX512;
+}
+
+// -------------------------------------------------------------------------- //
+
+SimdLevel CpuFeatures::simdLevel() {
+	return std::min(detectedLevel(), s_levelLimit.load(std::memory_order_relaxed));
+}
+
+// -------------------------------------------------------------------------- //
+
+void CpuFeatures::limitSimdLevel (SimdLevel level) {
+	s_levelLimit.store(level, std::memory_order_relaxed);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+// -------------------------------------------------------------------------- //
+/*
+	CpuFeatures class
+
+	tells which of the SIMD instruction set extensions the hand-written kernels rely on
+	may be used on the current CPU, taking into account whether the OS preserves
+	the wide registers across the context switches
+
+	every vectorized routine has a kernel per instruction set it's written for, the plain C++
+	one included, and the widest one the CPU supports is used (see selectKernel in Simd.h);
+	the level may be limited to a narrower one, so that the tests and the benchmarks could
+	run the other kernels on the same machine
+
+	the checks are done once, all the methods are cheap to call
+ */
+// -------------------------------------------------------------------------- //
+
+enum class SimdLevel {
+	None,
+	SSE2,
+	AVX2,
+	AVX512		// the F and BW subsets
+};
+
+class CpuFeatures {
+public:
+
+	static bool hasSSE2();
+	static bool hasAVX2();
+	static bool hasAVX512();	// the F and BW subsets
+
+	// the widest of the instruction sets above, no wider than the limit
+	static SimdLevel simdLevel();
+
+	// the kernels selected after the call use no wider instruction set than this one
+	static void limitSimdLevel (SimdLevel level);
+};
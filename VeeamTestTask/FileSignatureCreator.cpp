@@ -2,12 +2,18 @@
 #include "types.h"
 #include "FileSignatureCreator.h"
 #include "HashWrappers.h"
+#include "PlatformIO.h"
+#include "LockFreeQueue.h"
+#include "ContentChunker.h"
+#include "RollingChecksum.h"
+#include "SignatureFile.h"
 
 // -------------------------------------------------------------------------- //
 /*
 	InputFileReader class
 
-	processes the input file and reads it in chunks
+	processes the input file and reads it in chunks,
+	either through the OS cache or bypassing it
  */
 // -------------------------------------------------------------------------- //
 
@@ -19,9 +25,15 @@ public:
 	}
 	
 	template <class Source>
-	uint64_t open (const Source& filePath) {
+	uint64_t open (const Source& filePath, bool unbuffered = false) {
 		path inFilePath{ filePath };
 
+		if (unbuffered) {
+			m_unbufferedFile.reset(new UnbufferedFile(inFilePath));
+
+			return m_unbufferedFile->size();
+		}
+
 		uint64_t fileSize = static_cast<uint64_t>(file_size(inFilePath));
 
 		m_ifs.open(inFilePath, std::ios_base::in | std::ios_base::binary);
@@ -29,32 +41,118 @@ public:
 		return fileSize;
 	}
 
+	bool isUnbuffered() const { return static_cast<bool>(m_unbufferedFile); }
+
+	// moves on past the chunk that doesn't need to be read
+	void skipNextChunk (size_t length) {
+		if (isUnbuffered()) {
+			m_position += length;
+		} else {
+			m_ifs.seekg(length, std::ios_base::cur);
+		}
+	}
+
 	void readNextChunk(buffer_t& buffer) {
-		assert(buffer.size());
+		readNextChunk(buffer.data(), buffer.size());
+	}
 
-		m_ifs.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+	void readNextChunk(unsigned char* data, size_t length) {
+		assert(length && !isUnbuffered());
+
+		m_ifs.read(reinterpret_cast<char*>(data), length);
 		
-		assert(m_ifs.gcount() == buffer.size());
+		assert(m_ifs.gcount() == static_cast<std::streamsize>(length));
+	}
+
+	// only the data ranges of a sparse file are read, the holes are filled in with zeros
+
+	void readNextChunk(buffer_t& buffer, uint64_t offset, const std::vector<byte_range_t>& dataRanges) {
+		assert(buffer.size() && !isUnbuffered());
+
+		auto end = offset + buffer.size();
+		auto position = offset;
+
+		auto range = std::partition_point(dataRanges.begin(), dataRanges.end(),
+										  [offset](const byte_range_t& r) { return r.first + r.second <= offset; });
+
+		for (; range != dataRanges.end() && range->first < end; ++range) {
+			auto dataBegin = std::max(range->first, offset);
+			auto dataEnd = std::min(range->first + range->second, end);
+
+			fillHole(buffer.data() + (position - offset), dataBegin - position);
+
+			m_ifs.read(reinterpret_cast<char*>(buffer.data() + (dataBegin - offset)), dataEnd - dataBegin);
+
+			position = dataEnd;
+		}
+
+		fillHole(buffer.data() + (position - offset), end - position);
+	}
+
+	static_assert(bufferAlignment % UnbufferedFile::alignment() == 0, "Memory buffers are unsuitable for the unbuffered I/O");
+
+	// the unbuffered read is extended to the alignment boundaries on both sides
+	// (so the sectors on the block boundaries are read twice unless the block size is aligned too),
+	// returns the offset in the buffer the chunk data starts at
+
+	size_t readNextChunkUnbuffered(buffer_t& buffer, size_t length) {
+		assert(isUnbuffered());
+
+		auto alignment = UnbufferedFile::alignment();
+		auto dataOffset = static_cast<size_t>(m_position % alignment);
+		auto alignedLength = (dataOffset + length + alignment - 1) / alignment * alignment;
+
+		assert(alignedLength <= buffer.size());
+
+		if (m_unbufferedFile->readAt(buffer.data(), m_position - dataOffset, alignedLength) < dataOffset + length) {
+			throw std::ios_base::failure("Unexpected end of the input file");
+		}
+
+		m_position += length;
+
+		return dataOffset;
+	}
+
+	// the size of a buffer big enough for a chunk of the given length at any position
+	static size_t unbufferedBufferSize(size_t length) {
+		auto alignment = UnbufferedFile::alignment();
+
+		return (length + alignment - 1) / alignment * alignment + alignment;
+	}
+
+private:
+
+	void fillHole(unsigned char* data, uint64_t length) {
+		if (length) {
+			std::memset(data, 0, static_cast<size_t>(length));
+
+			m_ifs.seekg(length, std::ios_base::cur);
+		}
 	}
 
 private:
 
 	std::ifstream m_ifs;
+	std::unique_ptr<UnbufferedFile> m_unbufferedFile;
+	uint64_t m_position{ 0 };
 };
 
 // -------------------------------------------------------------------------- //
 /*
 	OutputFileWriter class
 
-	prepares the output file and writes to it in chunks
+	prepares the output file and writes to it in chunks,
+	or maps it into memory for the hashes to be stored in place
  */
 // -------------------------------------------------------------------------- //
 
 class OutputFileWriter {
 public:
 
+	// the table is everything that follows the header
+
 	template <class Source>
-	OutputFileWriter (const Source& filePath, unsigned int hashSize, uint64_t blockCount) : m_path(filePath) {
+	OutputFileWriter (const Source& filePath, uint64_t tableSize, bool mapped = false) : m_path(filePath) {
 		m_ofs.exceptions(std::ifstream::badbit | std::ifstream::failbit);
 
 		{
@@ -65,13 +163,19 @@ public:
 			m_ofs.close();
 		}
 
-		resize_file(m_path, SignatureHeaderTraits::size() + hashSize * blockCount);
+		resize_file(m_path, SignatureHeaderTraits::size() + tableSize);
 
-		m_ofs.open(m_path, std::ios_base::out | std::ios_base::binary);
+		if (mapped) {
+			m_mapping.reset(new MappedOutputFile(m_path));
+		} else {
+			m_ofs.open(m_path, std::ios_base::out | std::ios_base::binary);
+		}
 	}
 	
 	~OutputFileWriter() {
 		if (!m_isFinalized) {
+			// the file can't be deleted while it's mapped on some platforms
+			m_mapping.reset();
 			m_ofs.close();
 
 			std::error_code stub;
@@ -82,32 +186,257 @@ public:
 	}
 
 	void writeHeader (const SignatureHeader& header) {
-		m_ofs.seekp(0, std::ios_base::beg);
+		unsigned char bytes[SignatureHeaderTraits::size()];
+		auto pos = bytes;
+
+		auto put = [&pos](const auto& field) {
+			std::memcpy(pos, &field, sizeof(field));
+			pos += sizeof(field);
+		};
+
+		put(header.fileMark);
+		put(header.formatVersion);
+		put(header.hashFunctionId);
+		put(header.originalFileSize);
+		put(header.blockSize);
+		put(header.flags);
+		put(header.sourceWriteTime);
+
+		assert(pos == bytes + sizeof(bytes));
+
+		if (m_mapping) {
+			std::memcpy(m_mapping->data(), bytes, sizeof(bytes));
+		} else {
+			m_ofs.seekp(0, std::ios_base::beg);
+
+			m_ofs.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+		}
+	}
+
+	// the hashes of all the blocks, the tree over them and the weak checksums go right after the header in one go
+	// (along with the room for the section table, if any)
+	void writeHashes (const hash_t& hashes) {
+		assert(!isMapped());
+
+		m_ofs.seekp(SignatureHeaderTraits::size(), std::ios_base::beg);
+
+		m_ofs.write(reinterpret_cast<const char*>(hashes.data()), hashes.size());
+	}
 
-		m_ofs.write(reinterpret_cast<const char*>(&header.fileMark), sizeof(header.fileMark));
-		m_ofs.write(reinterpret_cast<const char*>(&header.formatVersion), sizeof(header.formatVersion));
-		m_ofs.write(reinterpret_cast<const char*>(&header.hashFunctionId), sizeof(header.hashFunctionId));
-		m_ofs.write(reinterpret_cast<const char*>(&header.originalFileSize), sizeof(header.originalFileSize));
-		m_ofs.write(reinterpret_cast<const char*>(&header.blockSize), sizeof(header.blockSize));
-		m_ofs.write(reinterpret_cast<const char*>(&header.reserved1), sizeof(header.reserved1));
-		m_ofs.write(reinterpret_cast<const char*>(&header.reserved2), sizeof(header.reserved2));
-		m_ofs.write(reinterpret_cast<const char*>(&header.reserved3), sizeof(header.reserved3));
+	// the limits of the content-defined chunks go right after the header, before their records
+	void writeChunkSizes (const ChunkSizes& sizes) {
+		assert(!isMapped());
+
+		unsigned char bytes[SignatureHeaderTraits::chunkSizesSize()];
+		auto pos = bytes;
+
+		auto put = [&pos](const auto& field) {
+			std::memcpy(pos, &field, sizeof(field));
+			pos += sizeof(field);
+		};
+
+		put(sizes.minSize);
+		put(sizes.averageSize);
+		put(sizes.maxSize);
+
+		assert(pos == bytes + sizeof(bytes));
+
+		m_ofs.seekp(SignatureHeaderTraits::size(), std::ios_base::beg);
+
+		m_ofs.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+
+		m_appendOffset = SignatureHeaderTraits::size() + sizeof(bytes);
 	}
 
-	void writeHash (uint64_t blockNumber, const hash_t& hash) {
-		m_ofs.seekp(SignatureHeaderTraits::size() + hash.size() * blockNumber, std::ios_base::beg);
+	// the table made in parts goes after the header part by part, as soon as each of them is complete
+	void appendHashes (const hash_t& part) {
+		assert(!isMapped());
+
+		m_ofs.seekp(m_appendOffset, std::ios_base::beg);
 
-		m_ofs.write(reinterpret_cast<const char*>(hash.data()), hash.size());
+		m_ofs.write(reinterpret_cast<const char*>(part.data()), part.size());
+
+		m_appendOffset += part.size();
+	}
+
+	// the table of the sections of a signature of the version 4 goes right after the header
+	void writeSections (const std::vector<SignatureSection>& sections) {
+		std::vector<unsigned char> bytes(SignatureHeaderTraits::sectionTableHeaderSize() +
+										 sections.size() * SignatureHeaderTraits::sectionEntrySize());
+		auto pos = bytes.data();
+
+		auto put = [&pos](const auto& field) {
+			std::memcpy(pos, &field, sizeof(field));
+			pos += sizeof(field);
+		};
+
+		put(static_cast<uint32_t>(sections.size()));
+		put(SignatureHeaderTraits::sectionEntrySize());
+
+		for (auto& section : sections) {
+			put(section.id);
+			put(section.itemSize);
+			put(section.offset);
+			put(section.size);
+		}
+
+		assert(pos == bytes.data() + bytes.size());
+
+		if (m_mapping) {
+			std::memcpy(m_mapping->data() + SignatureHeaderTraits::size(), bytes.data(), bytes.size());
+		} else {
+			m_ofs.seekp(SignatureHeaderTraits::size(), std::ios_base::beg);
+
+			m_ofs.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+		}
+	}
+
+	bool isMapped() const { return static_cast<bool>(m_mapping); }
+
+	// what follows the header of the mapped file, the hashes and the rest go there
+	unsigned char* hashTable() {
+		assert(isMapped());
+
+		return m_mapping->data() + SignatureHeaderTraits::size();
+	}
+
+	void finalize() {
+		if (m_mapping) {
+			m_mapping->flush();
+		}
+
+		m_isFinalized = true;
 	}
-	
-	void finalize() { m_isFinalized = true; }
 
 
 private:
 
 	path m_path;
 	std::ofstream m_ofs;
+	std::unique_ptr<MappedOutputFile> m_mapping;
 	bool m_isFinalized{ false };
+	uint64_t m_appendOffset{ SignatureHeaderTraits::size() };
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	MerkleTreeBuilder class
+
+	builds the Merkle tree over the block digests as they arrive: the hashers report
+	the runs of blocks they are done with, and the nodes above the blocks done from
+	the beginning of the file on are computed right away by one of the hashers at a time;
+	whatever is left by the end is computed by finish()
+ */
+// -------------------------------------------------------------------------- //
+
+class MerkleTreeBuilder {
+public:
+
+	// the leaves are filled in by the hashers, and the levels above them go one after another
+	// into a table of their own, which may or may not follow the leaves right away
+	MerkleTreeBuilder (unsigned char* leaves, unsigned char* levels, unsigned int digestSize, uint64_t leafCount) :
+		m_layout{ leafCount },
+		m_leaves{ leaves },
+		m_levels{ levels },
+		m_digestSize{ digestSize },
+		m_nodesBuilt(m_layout.levelCount(), 0),
+		m_nodeInput(1 + 2 * digestSize, MerkleTreeLayout::s_nodePrefix)
+	{}
+
+	const MerkleTreeLayout& layout() const { return m_layout; }
+
+	void leavesDone (uint64_t first, uint64_t count, GenericHashWrapper& hasher) {
+		uint64_t leavesDone;
+
+		{
+			std::lock_guard<std::mutex> lg{ m_guard };
+
+			if (first != m_leavesDone) {
+				m_pending.emplace(first, count);
+
+				return;
+			}
+
+			m_leavesDone += count;
+
+			// the runs done ahead of this one may follow it now
+
+			for (auto it = m_pending.begin(); it != m_pending.end() && it->first == m_leavesDone; it = m_pending.erase(it)) {
+				m_leavesDone += it->second;
+			}
+
+			leavesDone = m_leavesDone;
+		}
+
+		// the hasher busy with the tree already isn't waited for
+
+		std::unique_lock<std::mutex> building{ m_building, std::try_to_lock };
+
+		if (building) {
+			build(leavesDone, hasher);
+		}
+	}
+
+	void finish (GenericHashWrapper& hasher) {
+		std::lock_guard<std::mutex> building{ m_building };
+
+		assert(m_leavesDone == m_layout.levelSize(0) && m_pending.empty());
+
+		build(m_leavesDone, hasher);
+	}
+
+private:
+
+	void build (uint64_t leavesDone, GenericHashWrapper& hasher) {
+		auto ready = leavesDone;
+
+		for (size_t level = 1; level < m_layout.levelCount(); ++level) {
+			auto below = m_layout.levelSize(level - 1);
+
+			// a node needs both of its children, and the odd one at the end needs the whole level below
+
+			auto target = ready == below ? m_layout.levelSize(level) : ready / 2;
+
+			for (auto& n = m_nodesBuilt[level]; n < target; ++n) {
+				auto children = node(level - 1, 2 * n);
+
+				if (2 * n + 1 < below) {
+					std::memcpy(m_nodeInput.data() + 1, children, 2 * m_digestSize);
+
+					hasher.createDigest(m_nodeInput.data(), m_nodeInput.size(), node(level, n));
+				} else {
+					std::memcpy(node(level, n), children, m_digestSize);
+				}
+			}
+
+			ready = target;
+		}
+	}
+
+	unsigned char* node (size_t level, uint64_t index) {
+		if (!level) {
+			return m_leaves + static_cast<size_t>(index * m_digestSize);
+		}
+
+		return m_levels + static_cast<size_t>((m_layout.levelOffset(level) - m_layout.levelSize(0) + index) * m_digestSize);
+	}
+
+private:
+
+	MerkleTreeLayout m_layout;
+	unsigned char* m_leaves;
+	unsigned char* m_levels;
+	unsigned int m_digestSize;
+
+	// the blocks done from the beginning on, and the runs of them done out of order
+	std::mutex m_guard;
+	uint64_t m_leavesDone{ 0 };
+	std::map<uint64_t, uint64_t> m_pending;
+
+	// held by the one computing the nodes
+	std::mutex m_building;
+	std::vector<uint64_t> m_nodesBuilt;
+	std::vector<unsigned char> m_nodeInput;
 };
 
 // -------------------------------------------------------------------------- //
@@ -115,207 +444,326 @@ private:
 	FileSignatureCreatorImpl class
 
 	reads the file contents, splits it in blocks and hashes them efficiently,
-	and then drops the results into another file
+	and then either drops the results into another file or compares them
+	to the ones of an existing signature
  */
 // -------------------------------------------------------------------------- //
 
 class FileSignatureCreatorImpl {
 
 	using buffer_ptr_t = std::unique_ptr<buffer_t>;
-	using hash_ptr_t = std::unique_ptr<hash_t>;
-	using job_t = std::tuple<buffer_ptr_t, hash_ptr_t, uint64_t>;
-	using result_t = std::pair<hash_ptr_t, uint64_t>;
+	using window_ptr_t = std::shared_ptr<const MappedWindow>;
 
-	using job_queue_t = std::deque<job_t>;
-	using result_queue_t = std::deque<result_t>;
-	using buffer_pool_t = std::vector<buffer_ptr_t>;
-	using hash_pool_t = std::vector<hash_ptr_t>;
+	// a run of consecutive blocks of the input data to be hashed, it either occupies a buffer
+	// from the pool or points into a memory-mapped window of the input file shared by several runs
+
+	struct BlockData {
+		const unsigned char* data{ nullptr };
+		size_t size{ 0 };
+		buffer_ptr_t buffer;
+		window_ptr_t window;
+
+		// the sizes of the content-defined chunks the run is made of, if it is,
+		// and the records of the chunk table their digests go to
+		std::vector<uint32_t> chunks;
+		unsigned char* records{ nullptr };
+	};
+
+	// every job carries the number of the first block (or chunk) of the run,
+	// which tells where its digests go in the digest table
+
+	using job_t = std::pair<BlockData, uint64_t>;
+
+	using job_queue_t = BoundedQueue<job_t>;
+	using buffer_pool_t = BoundedQueue<buffer_ptr_t>;
+
+	// a large block shared among the hashers: whoever comes along takes the next part of it,
+	// and the hasher the block belongs to puts the results together once all the parts are done
+
+	struct SharedBlock {
+		const unsigned char* data{ nullptr };
+		size_t size{ 0 };
+		size_t partSize{ 0 };
+		size_t partCount{ 0 };
+		std::vector<unsigned char> results;
+
+		std::atomic<size_t> nextPart{ 0 };
+		std::atomic<size_t> partsDone{ 0 };
+		WaitPoint allPartsDone;
+	};
+
+	// the queue holds an invitation per helper wanted, the ones not taken
+	// by the time the block is done merely keep it from being deleted
+
+	using shared_block_ptr_t = std::shared_ptr<SharedBlock>;
+	using shared_block_queue_t = BoundedQueue<shared_block_ptr_t>;
 
-	static constexpr auto s_threadTimeout{ std::chrono::milliseconds{100} };
 	static constexpr auto s_defaultConcurrency{ 4 };
 
+	// the small blocks are batched into jobs of about this size, so that the cost of passing
+	// a job between the threads is spread over a number of blocks
+
+	static constexpr uint64_t s_jobPayloadSize{ 256 * 1024 };
+
+	// the hashers left without a job help the others to hash the blocks of the algorithms
+	// able to split them, which matters when there are few blocks in the file, as well as for
+	// the last blocks of any file; the parts are no smaller than this
+
+	static constexpr uint64_t s_minPartSize{ 1024 * 1024 };
+
+	// the async reads in flight take no more buffers than the jobs to read, and no more memory
+	// than this in total, though there's always one read at least
+
+	static constexpr uint64_t s_maxReadAheadSize{ 256 * 1024 * 1024 };
+
+	// mapped windows are sized to hold a whole number of blocks, and the total amount of
+	// the address space they occupy is capped to make the mode usable in 32-bit processes too
+
+	static constexpr uint64_t s_mappedWindowSize{ 64 * 1024 * 1024 };
+	static constexpr uint64_t s_mappedAddressSpaceLimit{ sizeof(void*) > 4 ? 2048ull * 1024 * 1024 : 256 * 1024 * 1024 };
+
 	class bad_flag_error : public std::exception {};
+	class size_mismatch_error : public std::exception {};
 
 public:
 
 	FileSignatureCreatorImpl() = default;
 	~FileSignatureCreatorImpl() {
 		waitForWorkers();
+
+		// the jobs left over after a failure may hold mapped windows,
+		// whose release relies on the other members being still alive
+		m_jobs.reset();
 	}
 
 	template <class Source>
-	void launch (const Source& inFilePath, const Source& outFilePath, uint32_t blockSize, HashFunctionId hash);
+	void launch (const Source& inFilePath, const Source& outFilePath, uint32_t blockSize, HashFunctionId hash,
+				 const SignatureOptions& options);
 
-private:
+	template <class Source>
+	void launch (const Source& inFilePath, const Source& outFilePath, const ChunkSizes& chunkSizes, HashFunctionId hash,
+				 const SignatureOptions& options);
 
-	void runHasher(HashWrapperPtr hasher);
-	void runResultWriter(OutputFileWriter& writer, uint64_t blocksToWrite);
-	void waitForWorkers() {
-		for (auto& t : m_workerPool) {
-			t.join();
-		}
+	template <class Source>
+	VerificationResult verify (const Source& inFilePath, const SignatureFile& signature, const SignatureOptions& options);
 
-		m_workerPool.clear();
-	}
+	template <class Source>
+	HashFunctionId update (const Source& inFilePath, const Source& outFilePath, const Source& baseSignaturePath,
+				 const ChangeHint& hint, const SignatureOptions& options);
 
 private:
 
-	std::vector<std::thread> m_workerPool;
-	
-	buffer_pool_t m_memoryBufferPool;
-	std::mutex m_mbpGuard;
+	// makes the signature, reuse(inputSize, blockCount) is called once the digest table and the tree
+	// are set up to fill in the digests that needn't be computed and to tell the jobs they belong to
 
-	hash_pool_t m_hashPool;
-	std::mutex m_hpGuard;
+	template <class Source, class Reuse>
+	void sign (const Source& inFilePath, const Source& outFilePath, uint32_t blockSize, HashFunctionId id,
+			   const SignatureOptions& options, Reuse reuse);
 
-	job_queue_t m_jobs;
-	std::mutex m_jobGuard;
+	// reads and hashes the input, prepare(inputSize, blockCount) is called once the input size and the job
+	// size are known to set up the place the digests go to and the jobs wanted; returns the input size
 
-	result_queue_t m_results;
-	std::mutex m_resGuard;
+	template <class Source, class Prepare>
+	uint64_t hashFile (const Source& inFilePath, uint32_t blockSize, HashFunctionId id,
+					   const SignatureOptions& options, Prepare prepare);
 
-	std::condition_variable m_jobsNotEmpty;
-	std::condition_variable m_jobsNotFull;
-	std::condition_variable m_resultsNotEmpty;
+	void readStreamed(InputFileReader& reader, uint64_t inputSize);
+	void readChunked(InputFileReader& reader, uint64_t inputSize);
+	void readMapped(const FileMapping& mapping, unsigned int hasherThreadCount);
+	void readAsync(AsyncFileReader& reader, bool unbuffered);
+	buffer_ptr_t acquireBuffer(bool wait);
+	void pushJob(BlockData block, uint64_t blockNumber);
 
-	std::atomic_bool m_badFlag{ false };
-	uint64_t m_blocksToHash{ 0 };
-};
+	// there should still be enough jobs for all the hashers to share, even if they become small;
+	// the algorithms hashing several blocks at a time fill their lanes from several jobs instead
+	// of getting the larger ones, which would make every buffer of the pool larger too
+	static uint32_t blocksPerJob(uint32_t blockSize, uint64_t blockCount, unsigned int hasherThreadCount) {
+		auto bySize = std::max<uint64_t>(s_jobPayloadSize / blockSize, 1);
+		auto byCount = std::max<uint64_t>(blockCount / (hasherThreadCount * 4ull), 1);
 
-// -------------------------------------------------------------------------- //
+		return static_cast<uint32_t>(std::min(bySize, byCount));
+	}
 
-template <class Source>
-void FileSignatureCreatorImpl::launch (const Source& inFilePath, const Source& outFilePath,
-									   uint32_t blockSize, HashFunctionId id) {
-	try {
-		if (!blockSize) {
-			throw std::invalid_argument("Block size is zero");
+	// the last write time of the file as it's recorded in the signature, zero if it can't be told
+	static uint64_t writeTimeOf (const path& filePath) {
+		std::error_code ec;
+
+		auto time = last_write_time(filePath, ec);
+
+		return ec ? 0 : static_cast<uint64_t>(time.time_since_epoch().count());
+	}
+
+	// the buffer pool is sized to hold every buffer in circulation, so a push never fails
+	template <class T>
+	static void push(BoundedQueue<T>& queue, T& value) {
+		if (!queue.tryPush(value)) {
+			assert(false);
+
+			throw std::runtime_error("Queue overflow");
 		}
+	}
+
+	void runHasher(HashWrapperPtr hasher);
+	void hashShared(GenericHashWrapper& hasher, const GenericHashWrapper::BlockRun& run);
+	void hashParts(GenericHashWrapper& hasher, SharedBlock& block);
+	void checkDigests(uint64_t firstBlock, size_t blockCount, const unsigned char* digests);
+	void storeWeakChecksums(uint64_t firstBlock, const unsigned char* data, size_t size);
+	void skipHoles(uint64_t inputSize, uint64_t blockCount, GenericHashWrapper& hasher);
+	void chunkPartDone(const unsigned char* records);
+	void addRuns(const job_t& job, unsigned char* digests, BlockContent* contents, std::vector<GenericHashWrapper::BlockRun>& runs);
+	bool inHole(uint64_t offset, size_t size) const;
+	void stop();
+
+	size_t blockCountOf(const job_t& job) const {
+		return job.first.records ? job.first.chunks.size() : (job.first.size + m_blockSize - 1) / m_blockSize;
+	}
 
-		InputFileReader reader;
-		auto inputSize = reader.open(inFilePath);
+	// the jobs not wanted are skipped by the readers, their digests are in place already
+	bool jobWanted(uint64_t jobNumber) const { return m_jobFilter.empty() || m_jobFilter[static_cast<size_t>(jobNumber)]; }
 
-		if (!inputSize) {
-			throw std::invalid_argument("Input file is empty");
+	void waitForWorkers() {
+		for (auto& t : m_workerPool) {
+			t.join();
 		}
 
-		auto digestSize = HashTraits::digestSize(id);
-		auto blockCount = m_blocksToHash = inputSize / blockSize + (inputSize % blockSize > 0);
+		m_workerPool.clear();
+	}
 
-		OutputFileWriter writer{ outFilePath, digestSize, m_blocksToHash };
+private:
 
-		auto hasherThreadCount = std::thread::hardware_concurrency();
+	std::vector<std::thread> m_workerPool;
+	
+	std::unique_ptr<buffer_pool_t> m_memoryBufferPool;
+	std::unique_ptr<job_queue_t> m_jobs;
+	std::unique_ptr<shared_block_queue_t> m_sharedBlocks;
 
-		if (!hasherThreadCount) {
-			hasherThreadCount = s_defaultConcurrency;
-		}
+	// signalled whenever there is a job or a shared block to help with
+	WaitPoint m_jobsAvailable;
 
-		// allocating the memory resources required
-		{
-			// we create a double amount of buffers in order to enable the reader thread
-			// to prefetch data while all the hasher threads are busy
+	// signalled whenever a buffer, a mapped window or a place in the job queue is given back
+	WaitPoint m_resourcesReleased;
 
-			m_memoryBufferPool.reserve(hasherThreadCount * 2);
-			m_hashPool.reserve(hasherThreadCount * 2);
+	// the digests of all the blocks in their order, every hasher writes to its own part of it,
+	// the table either lives in memory or in the mapped output file
 
-			for (unsigned i = 0; i < hasherThreadCount * 2; ++i) {
-				m_memoryBufferPool.emplace_back(new buffer_t(blockSize, unsigned char{0}));
-				m_hashPool.emplace_back(new hash_t(digestSize, unsigned char{0}));
-			}
-		}
+	hash_t m_digests;
+	unsigned char* m_digestTable{ nullptr };
+	unsigned int m_digestSize{ 0 };
 
-		// launching worker threads
-		{
-			m_workerPool.reserve(hasherThreadCount + 1);
+	// the tree over the digests, if it's wanted
+	std::unique_ptr<MerkleTreeBuilder> m_tree;
 
-			for (unsigned i = 0; i < hasherThreadCount; ++i) {
-				HashWrapperPtr hasher = HashWrapperFactory::createHashWrapper(id);
+	// the weak checksums of all the blocks follow the digest table if they are wanted,
+	// and so do the contents of the blocks, only found in the sections of their own though
 
-				m_workerPool.emplace_back(&FileSignatureCreatorImpl::runHasher, this, std::move(hasher));
-			}
+	unsigned char* m_weakChecksumTable{ nullptr };
+	unsigned char* m_blockContentTable{ nullptr };
 
-			m_workerPool.emplace_back(&FileSignatureCreatorImpl::runResultWriter, this, std::ref(writer), m_blocksToHash);
-		}
+	// the input is cut into content-defined chunks rather than blocks if there's a chunker,
+	// the reader adds a part to the chunk table for every job, and the hashers fill in the digests;
+	// the parts done from the first one on are written out and dropped right away, and the reader
+	// waits if too many of them are pending; the block size is the maximum chunk size then
 
-		// if we've reached so far then the files have been opened and their size
-		// either validated or set up, memory buffers allocated and threads launched
-		// we're ready for hashing
+	struct ChunkPart {
+		hash_t records;
+		bool done{ false };
+	};
 
-		uint64_t blockNumber{ 0 };
-		
-		for (auto bytesToRead = inputSize; blockNumber < blockCount; bytesToRead -= blockSize, ++blockNumber) {
-			buffer_ptr_t buffer;
+	std::unique_ptr<ContentChunker> m_chunker;
+	std::deque<ChunkPart> m_chunkParts;
+	std::mutex m_chunkGuard;
+	OutputFileWriter* m_chunkWriter{ nullptr };
 
-			{
-				std::unique_lock<std::mutex> ulBuffers{ m_mbpGuard };
+	// the jobs to be read and hashed, all of them if empty
+	std::vector<bool> m_jobFilter;
 
-				if (m_memoryBufferPool.empty()) {
-					while (!m_jobsNotFull.wait_for(ulBuffers, s_threadTimeout,
-												   [this]() { return !m_memoryBufferPool.empty() ||
-																	  m_badFlag.load(std::memory_order_relaxed);
-															}));
-				}
+	// the data ranges of a sparse input, empty if there are no holes in it
+	std::vector<byte_range_t> m_dataRanges;
 
-				if (m_badFlag.load(std::memory_order_relaxed)) {
-					throw bad_flag_error{};
-				}
+	// the digests of a block of zeros and of a short last one, given to the blocks lying in the holes
+	hash_t m_zeroDigest;
+	hash_t m_zeroTailDigest;
 
-				buffer = std::move(m_memoryBufferPool.back());
-				m_memoryBufferPool.resize(m_memoryBufferPool.size() - 1);
-			}
+	// the digests of the signature being verified against, the hashers compare theirs
+	// to these and keep the mismatching ones to themselves
 
-			if (bytesToRead < blockSize) {
-				// in case the last block is less than the others
-				
-				buffer->resize(static_cast<buffer_t::size_type>(bytesToRead));
-			}
+	const unsigned char* m_expectedDigests{ nullptr };
+	bool m_failFast{ false };
+	std::mutex m_mismatchGuard;
+	std::vector<block_range_t> m_mismatches;
+
+	uint32_t m_blockSize{ 0 };
+	uint32_t m_blocksPerJob{ 1 };
+	unsigned int m_maxParts{ 1 };
+	unsigned int m_hasherCount{ 0 };
 
-			reader.readNextChunk(*buffer.get());
+	// the number of the async reads kept in flight, up to the queue depth of the reader
+	unsigned int m_readDepth{ 0 };
 
-			hash_ptr_t hash;
+	std::atomic<unsigned int> m_liveWindows{ 0 };
+	std::atomic<unsigned int> m_busyHashers{ 0 };
+	std::atomic_bool m_badFlag{ false };
+	// set along with the bad flag when the hashing is stopped at the first mismatch rather than failed
+	std::atomic_bool m_stopped{ false };
+	// the jobs not hashed yet, the idle hashers keep waiting for a shared block to help with till it drops to zero
+	std::atomic<uint64_t> m_jobsToHash{ 0 };
+};
 
-			{
-				std::lock_guard<std::mutex> lg{ m_hpGuard };
+// -------------------------------------------------------------------------- //
 
-				if (m_hashPool.size()) {
-					hash = std::move(m_hashPool.back());
-					m_hashPool.resize(m_hashPool.size() - 1);
-				}				
-			}
+template <class Source>
+void FileSignatureCreatorImpl::launch (const Source& inFilePath, const Source& outFilePath,
+									   uint32_t blockSize, HashFunctionId id, const SignatureOptions& options) {
+	sign(inFilePath, outFilePath, blockSize, id, options, [](uint64_t, uint64_t) {});
+}
 
-			if (!hash) {
-				// hash buffers are relatively small and may be additionally allocated if so needed
+// -------------------------------------------------------------------------- //
 
-				hash.reset(new hash_t(digestSize, unsigned char{0}));
-			}
+template <class Source>
+void FileSignatureCreatorImpl::launch (const Source& inFilePath, const Source& outFilePath, const ChunkSizes& chunkSizes,
+									   HashFunctionId id, const SignatureOptions& options) {
+	// the chunks are cut one after another as the input is read
 
-			{
-				std::lock_guard<std::mutex> lg{ m_jobGuard };
+	if (options.readMode != ReadMode::Stream || options.directIo || options.mappedOutput || options.weakChecksums) {
+		throw std::invalid_argument("Content-defined chunks are only read in the stream mode with no direct I/O, mapped output or weak checksums");
+	}
 
-				m_jobs.emplace_back(std::move(buffer), std::move(hash), blockNumber);
-			}
+	if (options.merkleTree) {
+		throw std::invalid_argument("Content-defined chunks have no Merkle tree over them");
+	}
 
-			m_jobsNotEmpty.notify_one();
-		}
+	if (options.sectioned || options.blockContents) {
+		throw std::invalid_argument("Content-defined chunks make a signature of their own format");
+	}
 
-		waitForWorkers();
+	m_chunker.reset(new ContentChunker(chunkSizes.minSize, chunkSizes.averageSize, chunkSizes.maxSize));
 
-		if (m_badFlag.load(std::memory_order_relaxed)) {
-			throw bad_flag_error{};
-		}
+	try {
+		std::unique_ptr<OutputFileWriter> writer;
+
+		auto inputSize = hashFile(inFilePath, chunkSizes.maxSize, id, options, [&](uint64_t, uint64_t) {
+			// the size of the chunk table is only known in the end
+			writer.reset(new OutputFileWriter(outFilePath, 0));
+			writer->writeChunkSizes(chunkSizes);
+
+			m_chunkWriter = writer.get();
+		});
+
+		assert(m_chunkParts.empty());
 
 		SignatureHeader header;
 
+		header.formatVersion = SignatureHeaderTraits::chunkedVersion();
 		header.hashFunctionId = static_cast<decltype(header.hashFunctionId)>(id);
 		header.originalFileSize = inputSize;
-		header.blockSize = blockSize;
+		header.blockSize = chunkSizes.maxSize;
 
-		writer.writeHeader(header);
-		writer.finalize();
+		writer->writeHeader(header);
+		writer->finalize();
 	} catch (const bad_flag_error&) {
 		throw std::runtime_error("Worker thread error (most probably I/O related)");
 	} catch (...) {
-		m_badFlag.store(true, std::memory_order_relaxed);		
+		m_badFlag.store(true, std::memory_order_relaxed);
 
 		throw;
 	}
@@ -323,98 +771,951 @@ void FileSignatureCreatorImpl::launch (const Source& inFilePath, const Source& o
 
 // -------------------------------------------------------------------------- //
 
-void FileSignatureCreatorImpl::runHasher(HashWrapperPtr hasher) {
-	try {
-		while (true) {
-			job_t job;
-			
-			{
-				std::unique_lock<std::mutex> ulJobs{ m_jobGuard };			
-				
-				if (m_jobs.empty() && m_blocksToHash) {
-					while (!m_jobsNotEmpty.wait_for(ulJobs, s_threadTimeout,
-												    [this]() { return !m_jobs.empty() ||
-																	   m_badFlag.load(std::memory_order_relaxed) ||
-																	  !m_blocksToHash;
-															 }));
-				}
-
-				if (m_badFlag.load(std::memory_order_relaxed) ||
-					m_jobs.empty()) {
-
-					return;
-				}
-
-				// at this point we definitely a have a spare job
+template <class Source>
+HashFunctionId FileSignatureCreatorImpl::update (const Source& inFilePath, const Source& outFilePath, const Source& baseSignaturePath,
+												 const ChangeHint& hint, const SignatureOptions& options) {
+	path basePath{ baseSignaturePath };
+	std::error_code stub;
+
+	// the output file is emptied before the base signature is read
+	if (equivalent(basePath, path{ outFilePath }, stub)) {
+		throw std::invalid_argument("Output file is the base signature");
+	}
 
-				job = std::move(m_jobs[0]);
-				m_jobs.pop_front();
-				--m_blocksToHash;
-			}
+	SignatureFile base{ basePath };
 
-			auto& data = std::get<0>(job);
-			auto& hash = std::get<1>(job);
-			auto blockNumber = std::get<2>(job);
+	if (base.isChunked()) {
+		throw std::runtime_error("The base signature is made of content-defined chunks");
+	}
 
-			hasher->createDigest(*data.get(), *hash.get());
+	auto id = base.hashFunctionId();
+	auto digestSize = base.digestSize();
 
-			{
-				std::lock_guard<std::mutex> lg{ m_resGuard };
+	// without the ranges known, the input is either changed throughout or not at all,
+	// which the last write time recorded in the base tells
 
-				m_results.emplace_back(std::move(hash), blockNumber);
-			}
+	if (!hint.rangesKnown && !base.header().sourceWriteTime) {
+		throw std::runtime_error("The base signature doesn't record the last write time of its input, the dirty ranges must be given");
+	}
 
-			m_resultsNotEmpty.notify_one();
+	auto changed = hint.rangesKnown || writeTimeOf(path{ inFilePath }) != base.header().sourceWriteTime;
 
-			{
-				std::lock_guard<std::mutex> lg{ m_mbpGuard };
+	auto signOptions = options;
 
-				m_memoryBufferPool.emplace_back(std::move(data));
-			}
+	signOptions.merkleTree = base.hasMerkleTree();
+	signOptions.weakChecksums = base.hasWeakChecksums();
+	signOptions.sectioned = base.isSectioned();
+	signOptions.blockContents = base.hasBlockContents();
 
-			m_jobsNotFull.notify_one();
+	sign(inFilePath, outFilePath, base.header().blockSize, id, signOptions, [&](uint64_t inputSize, uint64_t blockCount) {
+		if (inputSize != base.header().originalFileSize) {
+			throw std::runtime_error("The input file size doesn't match the base signature");
 		}
-	} catch (...) {
-		m_badFlag.store(true, std::memory_order_relaxed);
-	}
-}
 
-// -------------------------------------------------------------------------- //
+		uint64_t jobSize = static_cast<uint64_t>(m_blockSize) * m_blocksPerJob;
+		auto jobCount = (blockCount + m_blocksPerJob - 1) / m_blocksPerJob;
 
-void FileSignatureCreatorImpl::runResultWriter(OutputFileWriter& writer, uint64_t blocksToWrite) {
-	try {
-		for (; blocksToWrite > 0; --blocksToWrite) {
-			result_t result;
-			
-			{
-				std::unique_lock<std::mutex> ulResults{ m_resGuard };
-
-				if (m_results.empty()) {
-					while (!m_resultsNotEmpty.wait_for(ulResults, s_threadTimeout,
-													   [this]() { return !m_results.empty() ||
-																		  m_badFlag.load(std::memory_order_relaxed);
-															    }));
-				}
+		m_jobFilter.assign(static_cast<size_t>(jobCount), changed && !hint.rangesKnown);
 
-				if (m_badFlag.load(std::memory_order_relaxed)) {
-					return;
+		if (hint.rangesKnown) {
+			for (auto& range : hint.dirtyRanges) {
+				if (!range.second || range.first >= inputSize) {
+					continue;
 				}
 
-				// at this point we definitely a have a spare result
+				auto last = range.first + std::min(range.second, inputSize - range.first) - 1;
 
-				result = std::move(m_results[0]);
-				m_results.pop_front();
+				std::fill(m_jobFilter.begin() + static_cast<size_t>(range.first / jobSize),
+						  m_jobFilter.begin() + static_cast<size_t>(last / jobSize + 1), true);
 			}
+		}
 
-			auto& hash = result.first;
-			auto blockNumber = result.second;
+		// the digests of the jobs skipped are taken from the base, and the tree, if any, is built over them right away
 
-			writer.writeHash(blockNumber, *hash.get());
-			
-			{
-				std::lock_guard<std::mutex> lg{ m_hpGuard };
+		auto hasher = HashWrapperFactory::createHashWrapper(id);
+
+		for (uint64_t job = 0; job < jobCount; ++job) {
+			if (m_jobFilter[static_cast<size_t>(job)]) {
+				continue;
+			}
+
+			auto firstBlock = job * m_blocksPerJob;
+			auto blocks = std::min<uint64_t>(m_blocksPerJob, blockCount - firstBlock);
+
+			std::memcpy(m_digestTable + static_cast<size_t>(firstBlock * digestSize), base.digest(firstBlock),
+						static_cast<size_t>(blocks * digestSize));
+
+			if (m_weakChecksumTable) {
+				std::memcpy(m_weakChecksumTable + static_cast<size_t>(firstBlock * RollingChecksum::s_size),
+							base.weakChecksums() + static_cast<size_t>(firstBlock * RollingChecksum::s_size),
+							static_cast<size_t>(blocks * RollingChecksum::s_size));
+			}
+
+			if (m_blockContentTable) {
+				std::memcpy(m_blockContentTable + static_cast<size_t>(firstBlock), base.blockContents() + static_cast<size_t>(firstBlock),
+							static_cast<size_t>(blocks));
+			}
+
+			if (m_tree) {
+				m_tree->leavesDone(firstBlock, blocks, *hasher);
+			}
+		}
+	});
+
+	return id;
+}
+
+// -------------------------------------------------------------------------- //
+
+template <class Source, class Reuse>
+void FileSignatureCreatorImpl::sign (const Source& inFilePath, const Source& outFilePath, uint32_t blockSize,
+									 HashFunctionId id, const SignatureOptions& options, Reuse reuse) {
+	try {
+		// the writer must outlive the hashers, since the digest table they write to may belong to it
+		std::unique_ptr<OutputFileWriter> writer;
+
+		SignatureHeader header;
+
+		header.flags = (options.merkleTree ? SignatureFlags::MerkleTree : 0) | (options.weakChecksums ? SignatureFlags::WeakChecksums : 0) |
+					   (options.blockContents ? SignatureFlags::BlockContents : 0);
+
+		// with nothing but the block digests to store, the signature is the same as the one of the version 1
+
+		if (options.sectioned || options.blockContents) {
+			header.formatVersion = SignatureHeaderTraits::sectionedVersion();
+		} else if (!header.flags) {
+			header.formatVersion = 1;
+		}
+
+		// the time is taken before the input is read, so that whatever is written meanwhile
+		// makes the input differ from the signature later on
+
+		if (header.formatVersion != 1) {
+			header.sourceWriteTime = writeTimeOf(path{ inFilePath });
+		}
+
+		std::vector<SignatureSection> sections;
+
+		auto inputSize = hashFile(inFilePath, blockSize, id, options, [&](uint64_t inputSize, uint64_t blockCount) {
+			auto digestSize = HashTraits::digestSize(id);
+
+			auto treeSize = digestSize * (options.merkleTree ? MerkleTreeLayout{ blockCount }.nodeCount() : blockCount);
+			auto checksumsSize = options.weakChecksums ? RollingChecksum::s_size * blockCount : 0;
+			auto tableSize = treeSize + checksumsSize;
+
+			if (header.formatVersion == SignatureHeaderTraits::sectionedVersion()) {
+				SignatureSectionLayout layout{ blockCount, digestSize, header.flags };
+
+				sections = layout.sections();
+				tableSize = layout.fileSize() - SignatureHeaderTraits::size();
+			}
+
+			writer.reset(new OutputFileWriter(outFilePath, tableSize, options.mappedOutput));
+
+			unsigned char* table;
+
+			if (writer->isMapped()) {
+				table = writer->hashTable();
+			} else {
+				m_digests.resize(static_cast<size_t>(tableSize));
+				table = m_digests.data();
+			}
+
+			// the parts of the table go one after another unless they are put in the sections
+
+			auto levels = table + static_cast<size_t>(digestSize * blockCount);
+
+			m_digestTable = table;
+
+			if (options.weakChecksums) {
+				m_weakChecksumTable = table + static_cast<size_t>(treeSize);
+			}
+
+			if (!sections.empty()) {
+				auto sectionData = [&](uint32_t id) {
+					auto section = SignatureSectionLayout::find(sections, id);
+
+					return section ? table + static_cast<size_t>(section->offset - SignatureHeaderTraits::size()) : nullptr;
+				};
+
+				m_digestTable = sectionData(SignatureSectionId::Digests);
+				m_blockContentTable = sectionData(SignatureSectionId::BlockContents);
+				m_weakChecksumTable = sectionData(SignatureSectionId::WeakChecksums);
+
+				levels = sectionData(SignatureSectionId::MerkleLevels);
+			}
+
+			if (options.merkleTree) {
+				m_tree.reset(new MerkleTreeBuilder(m_digestTable, levels, digestSize, blockCount));
+			}
+
+			reuse(inputSize, blockCount);
+		});
+
+		if (m_tree) {
+			m_tree->finish(*HashWrapperFactory::createHashWrapper(id));
+		}
+
+		header.hashFunctionId = static_cast<decltype(header.hashFunctionId)>(id);
+		header.originalFileSize = inputSize;
+		header.blockSize = blockSize;
+
+		// the header goes last so that an interrupted signature is never taken for a valid one
+
+		if (!writer->isMapped()) {
+			writer->writeHashes(m_digests);
+		}
+
+		if (!sections.empty()) {
+			writer->writeSections(sections);
+		}
+
+		writer->writeHeader(header);
+		writer->finalize();
+	} catch (const bad_flag_error&) {
+		throw std::runtime_error("Worker thread error (most probably I/O related)");
+	} catch (...) {
+		m_badFlag.store(true, std::memory_order_relaxed);		
+
+		throw;
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+template <class Source>
+VerificationResult FileSignatureCreatorImpl::verify (const Source& inFilePath, const SignatureFile& signature,
+													 const SignatureOptions& options) {
+	if (signature.isChunked()) {
+		throw std::runtime_error("The signature is made of content-defined chunks");
+	}
+
+	VerificationResult result;
+
+	result.hashFunctionId = signature.hashFunctionId();
+	result.blockSize = signature.header().blockSize;
+
+	try {
+		if (options.mappedOutput) {
+			throw std::invalid_argument("There is no output to map in the verification mode");
+		}
+
+		if (options.merkleTree || options.weakChecksums || options.blockContents) {
+			throw std::invalid_argument("There is no Merkle tree, weak checksums or block contents to store in the verification mode");
+		}
+
+		if (options.sectioned) {
+			throw std::invalid_argument("There is no signature to write in the verification mode");
+		}
+
+		m_expectedDigests = signature.digests();
+		m_failFast = options.failFast;
+
+		hashFile(inFilePath, result.blockSize, result.hashFunctionId, options, [&](uint64_t inputSize, uint64_t) {
+			// the blocks can't be matched against the ones of a file of another size
+			if (inputSize != signature.header().originalFileSize) {
+				throw size_mismatch_error{};
+			}
+		});
+	} catch (const size_mismatch_error&) {
+		result.sizeMatches = false;
+
+		return result;
+	} catch (const bad_flag_error&) {
+		if (!m_stopped.load()) {
+			throw std::runtime_error("Worker thread error (most probably I/O related)");
+		}
+
+		result.stoppedEarly = true;
+	} catch (...) {
+		m_badFlag.store(true, std::memory_order_relaxed);
+
+		throw;
+	}
+
+	// the hashers report the ranges within their jobs, the ones meeting at the job boundaries are joined
+
+	std::sort(m_mismatches.begin(), m_mismatches.end());
+
+	for (auto& range : m_mismatches) {
+		if (!result.mismatches.empty() && result.mismatches.back().second + 1 == range.first) {
+			result.mismatches.back().second = range.second;
+		} else {
+			result.mismatches.push_back(range);
+		}
+	}
+
+	return result;
+}
+
+// -------------------------------------------------------------------------- //
+
+template <class Source, class Prepare>
+uint64_t FileSignatureCreatorImpl::hashFile (const Source& inFilePath, uint32_t blockSize, HashFunctionId id,
+											 const SignatureOptions& options, Prepare prepare) {
+	if (!blockSize) {
+		throw std::invalid_argument("Block size is zero");
+	}
+
+	InputFileReader reader;
+	std::unique_ptr<FileMapping> mapping;
+	std::unique_ptr<AsyncFileReader> asyncReader;
+	uint64_t inputSize;
+
+	if (options.readMode == ReadMode::Mapped) {
+		if (options.directIo) {
+			throw std::invalid_argument("Direct I/O is not applicable to the mapped input");
+		}
+
+		mapping.reset(new FileMapping(path{ inFilePath }));
+		inputSize = mapping->size();
+	} else if (options.readMode == ReadMode::Async) {
+		if (!options.queueDepth) {
+			throw std::invalid_argument("Queue depth is zero");
+		}
+
+		asyncReader.reset(new AsyncFileReader(path{ inFilePath }, options.queueDepth, options.directIo));
+		inputSize = asyncReader->size();
+	} else {
+		inputSize = reader.open(inFilePath, options.directIo);
+	}
+
+	if (!inputSize) {
+		throw std::invalid_argument("Input file is empty");
+	}
+
+	auto digestSize = HashTraits::digestSize(id);
+	auto blockCount = inputSize / blockSize + (inputSize % blockSize > 0);
+
+	auto hasherThreadCount = std::thread::hardware_concurrency();
+
+	if (!hasherThreadCount) {
+		hasherThreadCount = s_defaultConcurrency;
+	}
+
+	m_digestSize = digestSize;
+	m_blockSize = blockSize;
+	m_blocksPerJob = blocksPerJob(blockSize, blockCount, hasherThreadCount);
+
+	m_hasherCount = hasherThreadCount;
+	m_maxParts = static_cast<unsigned int>(std::min<uint64_t>(hasherThreadCount, blockSize / s_minPartSize));
+
+	prepare(inputSize, blockCount);
+
+	// the chunks are cut out of whatever is read, the holes included
+
+	if (!m_chunker) {
+		SparseFileMap sparseMap{ path{ inFilePath } };
+
+		if (sparseMap.hasHoles()) {
+			m_dataRanges = sparseMap.dataRanges();
+
+			skipHoles(inputSize, blockCount, *HashWrapperFactory::createHashWrapper(id));
+		}
+	}
+
+	auto jobCount = (blockCount + m_blocksPerJob - 1) / m_blocksPerJob;
+	auto jobSize = static_cast<size_t>(blockSize) * m_blocksPerJob;
+
+	m_jobsToHash.store(m_jobFilter.empty() ? jobCount : static_cast<uint64_t>(std::count(m_jobFilter.begin(), m_jobFilter.end(), true)));
+
+	// the number of the chunked jobs isn't known in advance, the reader counts them as it goes,
+	// and holds one more till it's done
+
+	if (m_chunker) {
+		m_jobsToHash.store(1);
+	}
+
+	// allocating the memory resources required
+	{
+		// we create a double amount of buffers in order to enable the reader thread
+		// to prefetch data while all the hasher threads are busy, plus one buffer per
+		// every read that may be in flight in the async mode
+		// (no buffers are needed in the mapped mode since the data is hashed in place)
+		// the unbuffered reads need some room to be extended to the alignment boundaries
+
+		auto bufferSize = options.directIo ? InputFileReader::unbufferedBufferSize(jobSize) : jobSize;
+
+		if (asyncReader) {
+			auto byBudget = std::max<uint64_t>(s_maxReadAheadSize / bufferSize, 1);
+
+			m_readDepth = static_cast<unsigned int>(std::min<uint64_t>({ asyncReader->queueDepth(), m_jobsToHash.load(), byBudget }));
+		}
+
+		auto bufferCount = hasherThreadCount * 2 + m_readDepth;
+
+		// there's no use in more buffers than there are jobs to fill them
+
+		if (!m_chunker) {
+			bufferCount = static_cast<unsigned int>(std::min<uint64_t>(bufferCount, std::max<uint64_t>(m_jobsToHash.load(), 1)));
+		}
+
+		// the chunked jobs take at least the usual payload, and the buffer has room for the start
+		// of the chunk the next job begins with as well
+
+		if (m_chunker) {
+			bufferSize = static_cast<size_t>(std::max<uint64_t>(s_jobPayloadSize, m_chunker->maxSize()) + m_chunker->maxSize());
+		}
+
+		// the job queue capacity is what limits the amount of jobs in the mapped mode,
+		// the other modes run out of buffers first
+
+		m_jobs.reset(new job_queue_t(bufferCount));
+		m_sharedBlocks.reset(new shared_block_queue_t(hasherThreadCount * 2));
+		m_memoryBufferPool.reset(new buffer_pool_t(bufferCount));
+
+		if (!mapping) {
+			for (unsigned i = 0; i < bufferCount; ++i) {
+				buffer_ptr_t buffer{ new buffer_t(bufferSize) };
+
+				push(*m_memoryBufferPool, buffer);
+			}
+		}
+	}
+
+	try {
+		// launching worker threads
+		{
+			m_workerPool.reserve(hasherThreadCount);
+
+			for (unsigned i = 0; i < hasherThreadCount; ++i) {
+				HashWrapperPtr hasher = HashWrapperFactory::createHashWrapper(id);
+
+				hasher->detectPatterns(options.detectPatterns);
+
+				m_workerPool.emplace_back(&FileSignatureCreatorImpl::runHasher, this, std::move(hasher));
+			}
+		}
+
+		// if we've reached so far then the files have been opened and their size
+		// either validated or set up, memory buffers allocated and threads launched
+		// we're ready for hashing
+
+		if (m_chunker) {
+			readChunked(reader, inputSize);
+		} else if (mapping) {
+			readMapped(*mapping, hasherThreadCount);
+		} else if (asyncReader) {
+			readAsync(*asyncReader, options.directIo);
+		} else {
+			readStreamed(reader, inputSize);
+		}
+	} catch (...) {
+		// the hashers must be stopped before the digest table they write to goes away
+
+		m_badFlag.store(true, std::memory_order_relaxed);
+
+		waitForWorkers();
+
+		throw;
+	}
+
+	waitForWorkers();
+
+	if (m_badFlag.load(std::memory_order_relaxed)) {
+		throw bad_flag_error{};
+	}
+
+	return inputSize;
+}
+
+// -------------------------------------------------------------------------- //
+
+void FileSignatureCreatorImpl::readStreamed (InputFileReader& reader, uint64_t inputSize) {
+	uint64_t jobSize = static_cast<uint64_t>(m_blockSize) * m_blocksPerJob;
+	uint64_t blockNumber{ 0 };
+	
+	for (uint64_t offset = 0; offset < inputSize; offset += jobSize, blockNumber += m_blocksPerJob) {
+		// in case the last job is less than the others
+		auto length = static_cast<size_t>(std::min(inputSize - offset, jobSize));
+
+		if (!jobWanted(blockNumber / m_blocksPerJob)) {
+			reader.skipNextChunk(length);
+
+			continue;
+		}
+
+		auto buffer = acquireBuffer(true);
+
+		BlockData block;
+
+		if (reader.isUnbuffered()) {
+			block.data = buffer->data() + reader.readNextChunkUnbuffered(*buffer.get(), length);
+		} else {
+			buffer->resize(length);
+
+			if (m_dataRanges.empty()) {
+				reader.readNextChunk(*buffer.get());
+			} else {
+				reader.readNextChunk(*buffer.get(), offset, m_dataRanges);
+			}
+
+			block.data = buffer->data();
+		}
+
+		block.size = length;
+		block.buffer = std::move(buffer);
+
+		pushJob(std::move(block), blockNumber);
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+void FileSignatureCreatorImpl::readChunked (InputFileReader& reader, uint64_t inputSize) {
+	auto recordSize = SignatureHeaderTraits::chunkRecordSize(m_digestSize);
+	auto maxSize = m_chunker->maxSize();
+
+	auto buffer = acquireBuffer(true);
+	size_t filled{ 0 };
+	uint64_t chunkNumber{ 0 };
+
+	for (uint64_t offset = 0; offset < inputSize; ) {
+		auto length = static_cast<size_t>(std::min<uint64_t>(buffer->size() - filled, inputSize - offset - filled));
+
+		reader.readNextChunk(buffer->data() + filled, length);
+
+		filled += length;
+
+		auto last = offset + filled == inputSize;
+
+		// the chunks are cut as long as the next one is bound to end within the buffer,
+		// and the start of the one that may not is moved on to the next buffer
+
+		BlockData block;
+		size_t cut{ 0 };
+
+		while (cut < filled && (last || filled - cut >= maxSize)) {
+			auto size = m_chunker->nextChunk(buffer->data() + cut, filled - cut);
+
+			block.chunks.push_back(static_cast<uint32_t>(size));
+			cut += size;
+		}
+
+		// the records of a part are kept until the parts before it are done as well
+
+		m_resourcesReleased.wait([this]() { std::lock_guard<std::mutex> lg{ m_chunkGuard };
+
+											return m_chunkParts.size() < m_hasherCount * 4ull ||
+												   m_badFlag.load(std::memory_order_relaxed);
+										  });
+
+		if (m_badFlag.load(std::memory_order_relaxed)) {
+			throw bad_flag_error{};
+		}
+
+		unsigned char* record;
+
+		{
+			std::lock_guard<std::mutex> lg{ m_chunkGuard };
+
+			m_chunkParts.emplace_back();
+			m_chunkParts.back().records.resize(block.chunks.size() * recordSize);
+
+			record = m_chunkParts.back().records.data();
+		}
+
+		block.records = record;
+
+		auto chunkOffset = offset;
+
+		for (auto size : block.chunks) {
+			std::memcpy(record, &chunkOffset, sizeof(chunkOffset));
+			std::memcpy(record + sizeof(chunkOffset), &size, sizeof(size));
+
+			record += recordSize;
+			chunkOffset += size;
+		}
+
+		buffer_ptr_t next;
+
+		if (!last) {
+			next = acquireBuffer(true);
+
+			std::memcpy(next->data(), buffer->data() + cut, filled - cut);
+		}
+
+		block.data = buffer->data();
+		block.size = cut;
+		block.buffer = std::move(buffer);
+
+		auto chunkCount = block.chunks.size();
+
+		++m_jobsToHash;
+
+		pushJob(std::move(block), chunkNumber);
+
+		chunkNumber += chunkCount;
+		offset += cut;
+		filled -= cut;
+		buffer = std::move(next);
+	}
+
+	if (--m_jobsToHash == 0) {
+		m_jobsAvailable.notifyAll();
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+void FileSignatureCreatorImpl::readMapped (const FileMapping& mapping, unsigned int hasherThreadCount) {
+	auto inputSize = mapping.size();
+
+	// each window holds a whole number of jobs so that no job spans two of them,
+	// and there should be enough windows to keep all the hashers busy while the next one
+	// is being prefetched, as long as the address space limit allows
+
+	uint64_t jobSize = static_cast<uint64_t>(m_blockSize) * m_blocksPerJob;
+	uint64_t jobsPerWindow = std::max<uint64_t>(s_mappedWindowSize / jobSize, 1);
+	uint64_t windowSize = jobsPerWindow * jobSize;
+
+	auto windowsWanted = std::max<uint64_t>((hasherThreadCount * 2 + jobsPerWindow - 1) / jobsPerWindow, 2);
+	auto windowLimit = std::max<uint64_t>(s_mappedAddressSpaceLimit / windowSize, 2);
+	auto maxLiveWindows = std::min(windowsWanted, windowLimit);
+
+	for (uint64_t windowOffset = 0; windowOffset < inputSize; windowOffset += windowSize) {
+		auto windowLength = std::min(windowSize, inputSize - windowOffset);
+		auto firstJob = windowOffset / jobSize;
+		auto jobCount = (windowLength + jobSize - 1) / jobSize;
+
+		// the window none of whose jobs are wanted isn't even mapped
+
+		auto wanted = false;
+
+		for (uint64_t job = firstJob; job < firstJob + jobCount && !wanted; ++job) {
+			wanted = jobWanted(job);
+		}
+
+		if (!wanted) {
+			continue;
+		}
+
+		m_resourcesReleased.wait([this, maxLiveWindows]() { return m_liveWindows.load() < maxLiveWindows ||
+																   m_badFlag.load(std::memory_order_relaxed);
+														 });
+
+		if (m_badFlag.load(std::memory_order_relaxed)) {
+			throw bad_flag_error{};
+		}
+
+		++m_liveWindows;
+
+		// the window gets unmapped as soon as the last job referencing it is done
+
+		window_ptr_t window{ mapping.mapWindow(windowOffset, static_cast<size_t>(windowLength)).release(),
+							 [this](const MappedWindow* w) {
+								 delete w;
+
+								 --m_liveWindows;
+								 m_resourcesReleased.notifyOne();
+							 } };
+
+		for (uint64_t jobOffset = 0, job = firstJob; jobOffset < windowLength; jobOffset += jobSize, ++job) {
+			if (!jobWanted(job)) {
+				continue;
+			}
+
+			BlockData block;
+
+			block.data = window->data() + jobOffset;
+			block.size = static_cast<size_t>(std::min(jobSize, windowLength - jobOffset));
+			block.window = window;
+
+			pushJob(std::move(block), job * m_blocksPerJob);
+		}
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+void FileSignatureCreatorImpl::readAsync (AsyncFileReader& reader, bool unbuffered) {
+	auto inputSize = reader.size();
+	uint64_t jobSize = static_cast<uint64_t>(m_blockSize) * m_blocksPerJob;
+	auto jobCount = (inputSize + jobSize - 1) / jobSize;
+
+	// the reads only ever target the pooled buffers, so they are registered once and for all
+
+	{
+		std::vector<buffer_ptr_t> buffers;
+		std::vector<std::pair<unsigned char*, size_t>> regions;
+
+		for (buffer_ptr_t buffer; m_memoryBufferPool->tryPop(buffer); ) {
+			regions.emplace_back(buffer->data(), buffer->size());
+			buffers.push_back(std::move(buffer));
+		}
+
+		for (auto& buffer : buffers) {
+			push(*m_memoryBufferPool, buffer);
+		}
+
+		reader.registerBuffers(regions);
+	}
+
+	// the jobs being read along with the numbers of their first blocks, indexed by the request tag
+
+	std::vector<std::pair<BlockData, uint64_t>> inFlight(m_readDepth);
+	std::vector<uint64_t> freeTags(m_readDepth);
+
+	for (uint64_t tag = 0; tag < freeTags.size(); ++tag) {
+		freeTags[tag] = tag;
+	}
+
+	auto jobsWanted = m_jobFilter.empty() ? jobCount : static_cast<uint64_t>(std::count(m_jobFilter.begin(), m_jobFilter.end(), true));
+
+	try {
+		uint64_t jobNumber{ 0 };
+
+		for (uint64_t jobsRead = 0; jobsRead < jobsWanted; ++jobsRead) {
+			// topping the queue up as long as there are free buffers, and only waiting for
+			// the hashers to free some if there are no reads to wait for instead
+
+			while (jobNumber < jobCount && !freeTags.empty()) {
+				if (!jobWanted(jobNumber)) {
+					++jobNumber;
+
+					continue;
+				}
+
+				auto buffer = acquireBuffer(!reader.outstanding());
+
+				if (!buffer) {
+					break;
+				}
+
+				auto offset = jobNumber * jobSize;
+				auto length = static_cast<size_t>(std::min(jobSize, inputSize - offset));
+
+				// the unbuffered reads are extended to the alignment boundaries the same way
+				// InputFileReader does it
+
+				size_t dataOffset{ 0 };
+				auto readLength = length;
+
+				if (unbuffered) {
+					auto alignment = UnbufferedFile::alignment();
+
+					dataOffset = static_cast<size_t>(offset % alignment);
+					readLength = (dataOffset + length + alignment - 1) / alignment * alignment;
+				} else {
+					buffer->resize(length);
+				}
+
+				auto tag = freeTags.back();
+
+				reader.submitRead(buffer->data(), offset - dataOffset, readLength, tag);
+
+				freeTags.pop_back();
+
+				auto& block = inFlight[tag].first;
+
+				block.data = buffer->data() + dataOffset;
+				block.size = length;
+				block.buffer = std::move(buffer);
+				inFlight[tag].second = jobNumber++ * m_blocksPerJob;
+			}
+
+			auto tag = reader.waitForCompletion();
+			auto& completed = inFlight[tag];
+
+			pushJob(std::move(completed.first), completed.second);
+
+			freeTags.push_back(tag);
+		}
+	} catch (...) {
+		// the buffers of the reads still in flight may not be released until they are complete
+
+		reader.drain();
+
+		throw;
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+FileSignatureCreatorImpl::buffer_ptr_t FileSignatureCreatorImpl::acquireBuffer (bool wait) {
+	buffer_ptr_t buffer;
+
+	if (!m_memoryBufferPool->tryPop(buffer) && wait) {
+		m_resourcesReleased.wait([this, &buffer]() { return m_memoryBufferPool->tryPop(buffer) ||
+															m_badFlag.load(std::memory_order_relaxed);
+												   });
+	}
+
+	if (m_badFlag.load(std::memory_order_relaxed)) {
+		throw bad_flag_error{};
+	}
+
+	return buffer;
+}
 
-				m_hashPool.emplace_back(std::move(hash));
+// -------------------------------------------------------------------------- //
+
+void FileSignatureCreatorImpl::pushJob (BlockData block, uint64_t blockNumber) {
+	job_t job{ std::move(block), blockNumber };
+
+	if (!m_jobs->tryPush(job)) {
+		m_resourcesReleased.wait([this, &job]() { return m_jobs->tryPush(job) ||
+														 m_badFlag.load(std::memory_order_relaxed);
+												});
+
+		if (m_badFlag.load(std::memory_order_relaxed)) {
+			throw bad_flag_error{};
+		}
+	}
+
+	m_jobsAvailable.notifyOne();
+}
+
+// -------------------------------------------------------------------------- //
+
+void FileSignatureCreatorImpl::runHasher(HashWrapperPtr hasher) {
+	try {
+		auto batchSize = hasher->preferredBatchSize();
+		auto shareBlocks = m_maxParts > 1 && hasher->partResultSize() > 0;
+
+		std::vector<job_t> jobs;
+		std::vector<GenericHashWrapper::BlockRun> runs;
+
+		// the digests to be verified are only kept till they are compared
+		hash_t scratch;
+
+		while (true) {
+			job_t job;
+			shared_block_ptr_t sharedBlock;
+			auto popped = m_jobs->tryPop(job);
+
+			if (!popped) {
+				m_jobsAvailable.wait([this, &job, &popped, &sharedBlock]() { return (popped = m_jobs->tryPop(job)) ||
+																				   m_sharedBlocks->tryPop(sharedBlock) ||
+																				   m_badFlag.load(std::memory_order_relaxed) ||
+																				  !m_jobsToHash.load();
+																		  });
+			}
+
+			if (m_badFlag.load(std::memory_order_relaxed)) {
+				return;
+			}
+
+			if (sharedBlock) {
+				++m_busyHashers;
+
+				hashParts(*hasher, *sharedBlock);
+
+				--m_busyHashers;
+
+				continue;
+			}
+
+			if (!popped) {
+				return;
+			}
+
+			// at this point we definitely a have a spare job, and in case the hashing algorithm
+			// can process several blocks at a time, we take as many of the jobs at hand as it needs
+
+			++m_busyHashers;
+
+			jobs.push_back(std::move(job));
+
+			for (auto blocks = blockCountOf(jobs.back()); blocks < batchSize && m_jobs->tryPop(job); ) {
+				jobs.push_back(std::move(job));
+				blocks += blockCountOf(jobs.back());
+			}
+
+			// the reader may queue some more jobs now
+
+			m_resourcesReleased.notifyOne();
+
+			runs.clear();
+
+			if (m_expectedDigests) {
+				size_t blocks{ 0 };
+
+				for (auto& j : jobs) {
+					blocks += blockCountOf(j);
+				}
+
+				scratch.resize(blocks * m_digestSize);
+
+				auto digests = scratch.data();
+
+				for (auto& j : jobs) {
+					addRuns(j, digests, nullptr, runs);
+
+					digests += blockCountOf(j) * m_digestSize;
+				}
+			} else {
+				for (auto& j : jobs) {
+					if (!j.first.records) {
+						auto contents = m_blockContentTable ? reinterpret_cast<BlockContent*>(m_blockContentTable + static_cast<size_t>(j.second)) : nullptr;
+
+						addRuns(j, m_digestTable + static_cast<size_t>(m_digestSize * j.second), contents, runs);
+
+						continue;
+					}
+
+					// a run per chunk, with its digest put into its record
+
+					auto input = j.first.data;
+					auto record = j.first.records;
+
+					for (auto size : j.first.chunks) {
+						runs.push_back({ input, size, record + SignatureHeaderTraits::chunkRecordSize(0), nullptr });
+
+						input += size;
+						record += SignatureHeaderTraits::chunkRecordSize(m_digestSize);
+					}
+				}
+			}
+
+			if (shareBlocks) {
+				for (auto& run : runs) {
+					hashShared(*hasher, run);
+				}
+			} else {
+				hasher->createDigests(runs.data(), runs.size(), m_blockSize);
+			}
+
+			auto digests = scratch.data();
+
+			for (auto& j : jobs) {
+				if (m_expectedDigests) {
+					checkDigests(j.second, blockCountOf(j), digests);
+
+					digests += blockCountOf(j) * m_digestSize;
+				} else if (j.first.records) {
+					chunkPartDone(j.first.records);
+				} else {
+					if (m_weakChecksumTable) {
+						storeWeakChecksums(j.second, j.first.data, j.first.size);
+					}
+
+					if (m_tree) {
+						m_tree->leavesDone(j.second, blockCountOf(j), *hasher);
+					}
+				}
+			}
+
+			for (auto& j : jobs) {
+				if (j.first.buffer) {
+					push(*m_memoryBufferPool, j.first.buffer);
+
+					m_resourcesReleased.notifyOne();
+				}
+			}
+
+			// the mapped windows, if any, are released along with the jobs, which mustn't wait
+			// for the next batch: the reader may well be waiting for these very windows
+
+			auto jobCount = jobs.size();
+
+			jobs.clear();
+
+			--m_busyHashers;
+
+			if ((m_jobsToHash -= jobCount) == 0) {
+				// letting the idle hashers know there's nothing left for them
+				m_jobsAvailable.notifyAll();
 			}
 		}
 	} catch (...) {
@@ -422,6 +1723,295 @@ void FileSignatureCreatorImpl::runResultWriter(OutputFileWriter& writer, uint64_
 	}
 }
 
+// -------------------------------------------------------------------------- //
+
+void FileSignatureCreatorImpl::hashShared (GenericHashWrapper& hasher, const GenericHashWrapper::BlockRun& run) {
+	for (size_t offset = 0; offset < run.size; offset += m_blockSize) {
+		auto size = std::min<size_t>(m_blockSize, run.size - offset);
+		auto digest = run.digests + offset / m_blockSize * m_digestSize;
+
+		// there's nothing to share in a block of a uniform content
+
+		auto content = hasher.createCachedDigest(run.input + offset, size, digest);
+
+		if (run.contents) {
+			run.contents[offset / m_blockSize] = content;
+		}
+
+		if (content != BlockContent::Data) {
+			continue;
+		}
+
+		// the block is shared with the hashers neither busy nor about to take one of the queued jobs
+
+		auto busy = m_busyHashers.load() + m_jobs->size();
+		auto maxParts = std::min<size_t>(m_maxParts, busy < m_hasherCount ? m_hasherCount - busy + 1 : 1);
+		auto partSize = maxParts > 1 ? hasher.partSize(size, static_cast<unsigned int>(maxParts)) : 0;
+		auto partCount = partSize ? (size + partSize - 1) / partSize : 0;
+
+		if (partCount < 2) {
+			hasher.createDigest(run.input + offset, size, digest);
+
+			continue;
+		}
+
+		auto block = std::make_shared<SharedBlock>();
+
+		block->data = run.input + offset;
+		block->size = size;
+		block->partSize = partSize;
+		block->partCount = partCount;
+		block->results.resize(partCount * hasher.partResultSize());
+
+		// the owner is going to take a part as well, so there's no need to invite a helper for it
+
+		for (size_t i = 1; i < partCount; ++i) {
+			auto invitation = block;
+
+			if (!m_sharedBlocks->tryPush(invitation)) {
+				break;
+			}
+		}
+
+		m_jobsAvailable.notifyAll();
+
+		hashParts(hasher, *block);
+
+		block->allPartsDone.wait([&block]() { return block->partsDone.load() == block->partCount; });
+
+		hasher.combineParts(block->results.data(), partCount, partSize, size, digest);
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+void FileSignatureCreatorImpl::hashParts (GenericHashWrapper& hasher, SharedBlock& block) {
+	auto resultSize = hasher.partResultSize();
+
+	for (size_t part; (part = block.nextPart++) < block.partCount; ) {
+		auto offset = part * block.partSize;
+
+		hasher.hashPart(block.data + offset, std::min(block.partSize, block.size - offset), offset,
+						block.results.data() + part * resultSize);
+
+		if (++block.partsDone == block.partCount) {
+			block.allPartsDone.notifyAll();
+		}
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+void FileSignatureCreatorImpl::checkDigests (uint64_t firstBlock, size_t blockCount, const unsigned char* digests) {
+	auto expected = m_expectedDigests + static_cast<size_t>(firstBlock * m_digestSize);
+
+	auto differs = [this, expected, digests](size_t block) {
+		return std::memcmp(digests + block * m_digestSize, expected + block * m_digestSize, m_digestSize) != 0;
+	};
+
+	for (size_t block = 0; block < blockCount; ++block) {
+		if (!differs(block)) {
+			continue;
+		}
+
+		auto first = block;
+
+		while (block + 1 < blockCount && differs(block + 1)) {
+			++block;
+		}
+
+		{
+			std::lock_guard<std::mutex> lg{ m_mismatchGuard };
+
+			m_mismatches.emplace_back(firstBlock + first, firstBlock + block);
+		}
+
+		if (m_failFast) {
+			stop();
+
+			return;
+		}
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+void FileSignatureCreatorImpl::storeWeakChecksums (uint64_t firstBlock, const unsigned char* data, size_t size) {
+	auto checksums = m_weakChecksumTable + static_cast<size_t>(firstBlock * RollingChecksum::s_size);
+
+	for (size_t offset = 0; offset < size; offset += m_blockSize, checksums += RollingChecksum::s_size) {
+		auto checksum = RollingChecksum::compute(data + offset, std::min<size_t>(m_blockSize, size - offset));
+
+		std::memcpy(checksums, &checksum, sizeof(checksum));
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+void FileSignatureCreatorImpl::chunkPartDone (const unsigned char* records) {
+	{
+		std::lock_guard<std::mutex> lg{ m_chunkGuard };
+
+		auto part = std::find_if(m_chunkParts.begin(), m_chunkParts.end(), [records](const ChunkPart& p) {
+			return p.records.data() == records;
+		});
+
+		assert(part != m_chunkParts.end());
+
+		part->done = true;
+
+		while (!m_chunkParts.empty() && m_chunkParts.front().done) {
+			m_chunkWriter->appendHashes(m_chunkParts.front().records);
+
+			m_chunkParts.pop_front();
+		}
+	}
+
+	// the reader may add some more parts now
+
+	m_resourcesReleased.notifyOne();
+}
+
+// -------------------------------------------------------------------------- //
+
+void FileSignatureCreatorImpl::skipHoles (uint64_t inputSize, uint64_t blockCount, GenericHashWrapper& hasher) {
+	uint64_t jobSize = static_cast<uint64_t>(m_blockSize) * m_blocksPerJob;
+	auto jobCount = (blockCount + m_blocksPerJob - 1) / m_blocksPerJob;
+
+	if (m_jobFilter.empty()) {
+		m_jobFilter.assign(static_cast<size_t>(jobCount), true);
+	}
+
+	// the digests of zeros are computed once, the last block of the input may be a short one though;
+	// the weak checksums of zeros are zeros, which the table is filled with from the start
+
+	std::vector<unsigned char> zeros(m_blockSize);
+
+	m_zeroDigest.resize(m_digestSize);
+	hasher.createDigest(zeros.data(), zeros.size(), m_zeroDigest.data());
+
+	if (inputSize % m_blockSize) {
+		m_zeroTailDigest.resize(m_digestSize);
+		hasher.createDigest(zeros.data(), static_cast<size_t>(inputSize % m_blockSize), m_zeroTailDigest.data());
+	}
+
+	// the jobs lying in the holes entirely aren't even read, the hashers take care of the blocks
+	// lying in the holes of the rest
+
+	hash_t digests;
+	auto range = m_dataRanges.begin();
+
+	for (uint64_t job = 0; job < jobCount; ++job) {
+		auto offset = job * jobSize;
+		auto end = std::min(offset + jobSize, inputSize);
+
+		while (range != m_dataRanges.end() && range->first + range->second <= offset) {
+			++range;
+		}
+
+		if (!m_jobFilter[static_cast<size_t>(job)] || (range != m_dataRanges.end() && range->first < end)) {
+			continue;
+		}
+
+		auto firstBlock = job * m_blocksPerJob;
+		auto blocks = static_cast<size_t>(std::min<uint64_t>(m_blocksPerJob, blockCount - firstBlock));
+
+		digests.resize(blocks * m_digestSize);
+
+		for (size_t block = 0; block < blocks; ++block) {
+			auto& digest = (end == inputSize && block == blocks - 1 && !m_zeroTailDigest.empty()) ? m_zeroTailDigest : m_zeroDigest;
+
+			std::memcpy(digests.data() + block * m_digestSize, digest.data(), m_digestSize);
+		}
+
+		m_jobFilter[static_cast<size_t>(job)] = false;
+
+		if (m_expectedDigests) {
+			checkDigests(firstBlock, blocks, digests.data());
+		} else {
+			std::memcpy(m_digestTable + static_cast<size_t>(firstBlock * m_digestSize), digests.data(), blocks * m_digestSize);
+
+			if (m_blockContentTable) {
+				std::memset(m_blockContentTable + static_cast<size_t>(firstBlock), static_cast<int>(BlockContent::Zeros), blocks);
+			}
+
+			if (m_tree) {
+				m_tree->leavesDone(firstBlock, blocks, hasher);
+			}
+		}
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+void FileSignatureCreatorImpl::addRuns (const job_t& job, unsigned char* digests, BlockContent* contents,
+										std::vector<GenericHashWrapper::BlockRun>& runs) {
+	if (m_dataRanges.empty()) {
+		runs.push_back({ job.first.data, job.first.size, digests, contents });
+
+		return;
+	}
+
+	// a job of a sparse input is split into the runs of the blocks holding some data,
+	// the blocks lying in the holes get the digest of zeros without being hashed
+
+	auto jobOffset = job.second * m_blockSize;
+	size_t runStart = 0;
+
+	for (size_t offset = 0; offset < job.first.size; offset += m_blockSize) {
+		auto size = std::min<size_t>(m_blockSize, job.first.size - offset);
+
+		if (!inHole(jobOffset + offset, size)) {
+			continue;
+		}
+
+		auto block = offset / m_blockSize;
+
+		if (offset > runStart) {
+			auto first = runStart / m_blockSize;
+
+			runs.push_back({ job.first.data + runStart, offset - runStart, digests + first * m_digestSize, contents ? contents + first : nullptr });
+		}
+
+		std::memcpy(digests + block * m_digestSize, (size < m_blockSize ? m_zeroTailDigest : m_zeroDigest).data(), m_digestSize);
+
+		if (contents) {
+			contents[block] = BlockContent::Zeros;
+		}
+
+		runStart = offset + size;
+	}
+
+	if (job.first.size > runStart) {
+		auto first = runStart / m_blockSize;
+
+		runs.push_back({ job.first.data + runStart, job.first.size - runStart, digests + first * m_digestSize, contents ? contents + first : nullptr });
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+bool FileSignatureCreatorImpl::inHole (uint64_t offset, size_t size) const {
+	// the first data range ending past the offset is the only one which may overlap the bytes
+
+	auto range = std::partition_point(m_dataRanges.begin(), m_dataRanges.end(), [offset](const byte_range_t& r) {
+		return r.first + r.second <= offset;
+	});
+
+	return range == m_dataRanges.end() || range->first >= offset + size;
+}
+
+// -------------------------------------------------------------------------- //
+
+void FileSignatureCreatorImpl::stop() {
+	m_stopped.store(true);
+	m_badFlag.store(true, std::memory_order_relaxed);
+
+	// the reader and the hashers may be waiting for one another
+	m_jobsAvailable.notifyAll();
+	m_resourcesReleased.notifyAll();
+}
+
 // -------------------------------------------------------------------------- //
 /*
 	FileSignatureCreator methods implementation
@@ -429,18 +2019,86 @@ void FileSignatureCreatorImpl::runResultWriter(OutputFileWriter& writer, uint64_
 // -------------------------------------------------------------------------- //
 
 FileSignatureCreator::FileSignatureCreator (const char* inFilePath, const char* outFilePath,
-											uint32_t blockSize, HashFunctionId id) {
+											uint32_t blockSize, HashFunctionId id, const SignatureOptions& options) {
+	FileSignatureCreatorImpl impl;
+
+	impl.launch(inFilePath, outFilePath, blockSize, id, options);
+}
+
+// -------------------------------------------------------------------------- //
+
+FileSignatureCreator::FileSignatureCreator (const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* inFilePath,
+										    const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* outFilePath,
+											uint32_t blockSize, HashFunctionId id, const SignatureOptions& options) {
+	FileSignatureCreatorImpl impl;
+
+	impl.launch(inFilePath, outFilePath, blockSize, id, options);
+}
+
+// -------------------------------------------------------------------------- //
+
+FileSignatureCreator::FileSignatureCreator (const char* inFilePath, const char* outFilePath,
+											const ChunkSizes& chunkSizes, HashFunctionId id, const SignatureOptions& options) {
 	FileSignatureCreatorImpl impl;
 
-	impl.launch(inFilePath, outFilePath, blockSize, id);
+	impl.launch(inFilePath, outFilePath, chunkSizes, id, options);
 }
 
 // -------------------------------------------------------------------------- //
 
 FileSignatureCreator::FileSignatureCreator (const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* inFilePath,
 										    const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* outFilePath,
-											uint32_t blockSize, HashFunctionId id) {
+											const ChunkSizes& chunkSizes, HashFunctionId id, const SignatureOptions& options) {
+	FileSignatureCreatorImpl impl;
+
+	impl.launch(inFilePath, outFilePath, chunkSizes, id, options);
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	FileSignatureVerifier methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+FileSignatureVerifier::FileSignatureVerifier (const char* inFilePath, const char* signaturePath,
+											  const SignatureOptions& options) {
+	SignatureFile signature{ path{ signaturePath } };
+	FileSignatureCreatorImpl impl;
+
+	m_result = impl.verify(inFilePath, signature, options);
+}
+
+// -------------------------------------------------------------------------- //
+
+FileSignatureVerifier::FileSignatureVerifier (const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* inFilePath,
+											  const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* signaturePath,
+											  const SignatureOptions& options) {
+	SignatureFile signature{ path{ signaturePath } };
+	FileSignatureCreatorImpl impl;
+
+	m_result = impl.verify(inFilePath, signature, options);
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	FileSignatureUpdater methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+FileSignatureUpdater::FileSignatureUpdater (const char* inFilePath, const char* outFilePath, const char* baseSignaturePath,
+											const ChangeHint& hint, const SignatureOptions& options) {
+	FileSignatureCreatorImpl impl;
+
+	m_hashFunctionId = impl.update(inFilePath, outFilePath, baseSignaturePath, hint, options);
+}
+
+// -------------------------------------------------------------------------- //
+
+FileSignatureUpdater::FileSignatureUpdater (const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* inFilePath,
+											const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* outFilePath,
+											const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* baseSignaturePath,
+											const ChangeHint& hint, const SignatureOptions& options) {
 	FileSignatureCreatorImpl impl;
 
-	impl.launch(inFilePath, outFilePath, blockSize, id);
+	m_hashFunctionId = impl.update(inFilePath, outFilePath, baseSignaturePath, hint, options);
 }
\ No newline at end of file
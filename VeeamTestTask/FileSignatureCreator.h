@@ -2,6 +2,8 @@
 
 #include <cstdint>
 #include <filesystem>
+#include <utility>
+#include <vector>
 
 #include "types.h"
 
@@ -17,26 +19,295 @@ using namespace std::filesystem;
 
 	represents the header of the signature file
 	note that the struct is serialized on a per-field basis, with no padding assumed
+
+	format versions:
+	- 1 - the header is followed by the digests of all the blocks
+	- 2 - the flags tell what else is there, the block digests may be followed
+		  by the upper levels of a Merkle tree over them (see MerkleTreeLayout),
+		  and then by the weak rolling checksums of the blocks (see RollingChecksum),
+		  four bytes each, so that every block has a pair of a weak and a strong one
+	- 3 - the input is cut into the content-defined chunks of variable size (see ContentChunker)
+		  rather than the blocks, the header is followed by the minimum, the average and the maximum
+		  chunk sizes (4 bytes each, see ChunkSizes), and then by a record per chunk: its offset
+		  (8 bytes), its size (4 bytes) and its digest; the block size is the maximum chunk size
+	- 4 - the same contents as the version 2 and then some, put in the sections listed
+		  in the table right after the header (see SignatureSectionLayout), every one of them
+		  starting at a page boundary so that it may be mapped and read in place;
+		  the flags tell which sections are there, and the sections of unknown kinds are to be skipped
+
+	the version 4 is only written if asked for, otherwise the block digests go right
+	after the header the way they do in the version 1, with whatever else there is after them;
+	with nothing else there, the signature is written in the version 1 itself
  */
 // -------------------------------------------------------------------------- //
 
+struct SignatureFlags {
+	static constexpr uint32_t MerkleTree{ 1 };
+	static constexpr uint32_t WeakChecksums{ 2 };
+	static constexpr uint32_t BlockContents{ 4 };
+};
+
 struct SignatureHeader {
 	uint32_t fileMark{ 0x53464D56 }; // this should look like "VMFS", Veeam File Signature
-	uint16_t formatVersion{ 1 };
+	uint16_t formatVersion{ 2 };
 	uint16_t hashFunctionId{ 0 };
 	uint64_t originalFileSize{ 0 };
 	uint32_t blockSize{ 0 };
-	
-	// reserved fields to pad the structure to have the size of 32
-	uint32_t reserved1{ 0 };
-	uint32_t reserved2{ 0 };
-	uint32_t reserved3{ 0 };
+	uint32_t flags{ 0 };
+
+	// the last write time of the input as it was signed, in the ticks of the file clock, recorded
+	// in the versions 2 and 4 only, the field is zero in the rest
+	uint64_t sourceWriteTime{ 0 };
 };
 
 class SignatureHeaderTraits {
 public:
 
 	static constexpr uint32_t size() { return 32; }
+
+	static constexpr uint16_t chunkedVersion() { return 3; }
+	static constexpr uint32_t chunkSizesSize() { return 12; }
+	static constexpr uint32_t chunkRecordSize (unsigned int digestSize) { return 12 + digestSize; }
+
+	static constexpr uint16_t sectionedVersion() { return 4; }
+	static constexpr uint32_t sectionTableHeaderSize() { return 8; }
+	static constexpr uint32_t sectionEntrySize() { return 24; }
+	static constexpr uint32_t sectionAlignment() { return 4096; }
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	MerkleTreeLayout class
+
+	tells where the nodes of the Merkle tree over the block digests are in the signature file
+
+	the leaves are the block digests, every upper level is made of the digests of the pairs
+	of the nodes below, H(0x01 | left | right) with the hash function of the blocks, and the odd
+	node at the end of a level is moved up as it is; the levels go one after another, from
+	the leaves up to the root, which is the digest of the whole file
+ */
+// -------------------------------------------------------------------------- //
+
+class MerkleTreeLayout {
+public:
+
+	static constexpr unsigned char s_nodePrefix{ 0x01 };
+
+	explicit MerkleTreeLayout (uint64_t leafCount) {
+		m_levelOffsets.push_back(0);
+
+		for (auto size = leafCount; size; size = size > 1 ? (size + 1) / 2 : 0) {
+			m_levelOffsets.push_back(m_levelOffsets.back() + size);
+		}
+	}
+
+	size_t levelCount() const { return m_levelOffsets.size() - 1; }
+
+	// the offsets are counted in nodes from the first leaf
+	uint64_t levelOffset (size_t level) const { return m_levelOffsets[level]; }
+	uint64_t levelSize (size_t level) const { return m_levelOffsets[level + 1] - m_levelOffsets[level]; }
+
+	uint64_t nodeCount() const { return m_levelOffsets.back(); }
+	uint64_t rootOffset() const { return nodeCount() - 1; }
+
+private:
+
+	std::vector<uint64_t> m_levelOffsets;
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	SignatureSectionLayout class
+
+	tells where the sections of a signature of the version 4 are: the table of them follows
+	the header, starting with the number of its entries and the size of an entry (4 bytes each),
+	then an entry per section made of its kind and the size of its items (4 bytes each),
+	and its offset from the beginning of the file and its size in bytes (8 bytes each);
+	the sections go in the order of their kinds, every one of them at a page boundary
+
+	section kinds:
+	- Digests - the digests of the blocks
+	- BlockContents - what every block is made of, a byte per block (see BlockContent)
+	- MerkleLevels - the levels of the Merkle tree above the block digests (see MerkleTreeLayout)
+	- WeakChecksums - the weak rolling checksums of the blocks (see RollingChecksum)
+ */
+// -------------------------------------------------------------------------- //
+
+struct SignatureSectionId {
+	static constexpr uint32_t Digests{ 1 };
+	static constexpr uint32_t BlockContents{ 2 };
+	static constexpr uint32_t MerkleLevels{ 3 };
+	static constexpr uint32_t WeakChecksums{ 4 };
+};
+
+struct SignatureSection {
+	uint32_t id{ 0 };
+	uint32_t itemSize{ 0 };
+	uint64_t offset{ 0 };
+	uint64_t size{ 0 };
+};
+
+class SignatureSectionLayout {
+public:
+
+	// the sections the flags of the header call for, the weak checksums are 4 bytes each
+	SignatureSectionLayout (uint64_t blockCount, unsigned int digestSize, uint32_t flags) {
+		add(SignatureSectionId::Digests, digestSize, blockCount);
+
+		if (flags & SignatureFlags::BlockContents) {
+			add(SignatureSectionId::BlockContents, 1, blockCount);
+		}
+
+		if (flags & SignatureFlags::MerkleTree) {
+			add(SignatureSectionId::MerkleLevels, digestSize, MerkleTreeLayout{ blockCount }.nodeCount() - blockCount);
+		}
+
+		if (flags & SignatureFlags::WeakChecksums) {
+			add(SignatureSectionId::WeakChecksums, 4, blockCount);
+		}
+
+		// the sections can only be placed once their number is known
+
+		auto offset = alignedOffset(SignatureHeaderTraits::size() + SignatureHeaderTraits::sectionTableHeaderSize() +
+									SignatureHeaderTraits::sectionEntrySize() * m_sections.size());
+
+		for (auto& section : m_sections) {
+			section.offset = offset;
+			offset = alignedOffset(offset + section.size);
+		}
+	}
+
+	const std::vector<SignatureSection>& sections() const { return m_sections; }
+
+	// the last section isn't padded
+	uint64_t fileSize() const { return m_sections.back().offset + m_sections.back().size; }
+
+	static const SignatureSection* find (const std::vector<SignatureSection>& sections, uint32_t id) {
+		for (auto& section : sections) {
+			if (section.id == id) {
+				return &section;
+			}
+		}
+
+		return nullptr;
+	}
+
+	static uint64_t alignedOffset (uint64_t offset) {
+		auto alignment = SignatureHeaderTraits::sectionAlignment();
+
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+private:
+
+	void add (uint32_t id, uint32_t itemSize, uint64_t itemCount) {
+		SignatureSection section;
+
+		section.id = id;
+		section.itemSize = itemSize;
+		section.size = itemSize * itemCount;
+
+		m_sections.push_back(section);
+	}
+
+private:
+
+	std::vector<SignatureSection> m_sections;
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	SignatureOptions struct
+
+	tunes the way the input file is processed, doesn't affect the signature contents
+	but for the weakChecksums, sectioned and blockContents options
+
+	readMode:
+	- Stream - the input is read sequentially into a pool of memory buffers
+	- Mapped - the input is memory-mapped in sliding windows and hashed in place,
+			   with no intermediate copying
+	- Async - the input is read into a pool of memory buffers with queueDepth reads
+			  in flight at a time (io_uring on Linux, overlapped I/O on Windows)
+
+	directIo - the input is read bypassing the OS cache so as not to evict anything else from it,
+			   not applicable to the Mapped mode
+
+	mappedOutput - the hashes are stored straight into the memory-mapped output file
+				   rather than collected in memory and written at the end
+
+	failFast - the verification stops at the first mismatching block found
+
+	detectPatterns - the blocks made of a short pattern repeated (a fill byte, a sector template)
+					 get the digest computed once per pattern rather than being hashed,
+					 which costs a little for every other block
+
+	weakChecksums - the weak rolling checksum of every block is stored along with its digest
+
+	sectioned - the signature is written in the version 4, its parts aligned to the page boundaries
+
+	blockContents - what every block is made of (zeros, a pattern or anything else) is stored
+					along with its digest, only in the version 4, which it implies
+ */
+// -------------------------------------------------------------------------- //
+
+enum class ReadMode : uint8_t {
+	Stream = 0,
+	Mapped = 1,
+	Async = 2
+};
+
+struct SignatureOptions {
+	ReadMode readMode{ ReadMode::Stream };
+	unsigned int queueDepth{ 32 };
+	bool directIo{ false };
+	bool mappedOutput{ false };
+	bool failFast{ false };
+	bool detectPatterns{ false };
+	bool merkleTree{ false };
+	bool weakChecksums{ false };
+	bool sectioned{ false };
+	bool blockContents{ false };
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	ChangeHint struct
+
+	tells which parts of the input have changed since the base signature was made
+
+	dirtyRanges - the ranges of the input that have changed, as the offsets and lengths in bytes,
+				  only used if rangesKnown is set; otherwise the input is taken as unchanged
+				  if its last write time is the one recorded in the base signature, and as changed
+				  throughout if it isn't, and the base signature must record the time then
+
+	the extents of the input (FIEMAP) tell nothing here: the filesystems overwriting the data
+	in place, like ext4 or NTFS, keep the extents of the blocks overwritten, so the digests
+	of those would be reused; nor is there anything like FIEMAP on Windows
+ */
+// -------------------------------------------------------------------------- //
+
+// the offset and the length of a range of bytes
+using byte_range_t = std::pair<uint64_t, uint64_t>;
+
+struct ChangeHint {
+	bool rangesKnown{ false };
+	std::vector<byte_range_t> dirtyRanges;
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	ChunkSizes struct
+
+	the limits of the content-defined chunks the input may be cut into instead of the blocks:
+	the minimum size is at least 64 bytes, and the average one is a power of two no less than
+	the minimum and no more than the maximum
+ */
+// -------------------------------------------------------------------------- //
+
+struct ChunkSizes {
+	uint32_t minSize{ 2 * 1024 };
+	uint32_t averageSize{ 8 * 1024 };
+	uint32_t maxSize{ 64 * 1024 };
 };
 
 // -------------------------------------------------------------------------- //
@@ -46,15 +317,20 @@ public:
 	create an object of this class to start hasing the input file into the output file
 	using the block size and hash function provided
 
+	the input may be cut into the content-defined chunks of the sizes given instead, and those are
+	only read in the Stream mode with no direct I/O, and make neither mapped output nor weak checksums,
+	nor a signature of the version 4
+
 	if the output path points to an already existing file, may delete its contents.
 	if the hashing fails during the process, will attempt to delete an output file
 
 	may throw:
-	- std::invalid_argument - in case the file paths are invalid or the block size is zero
+	- std::invalid_argument - in case the file paths are invalid, the block size is zero, the chunk sizes
+							  are wrong or the options don't apply to the chunks
 	- std::ios_base::failure - in case of I/O errors
 	- std::runtime_error - in case of an internal error, most probably I/O related
 	- std::bad_alloc - in case of memory shortage
-	- std::system_error - in case of thread-related issues
+	- std::system_error - in case of thread-related issues or memory mapping errors
 	- std::filesystem_error - in case of the filesystem errors
  */
 // -------------------------------------------------------------------------- //
@@ -63,10 +339,114 @@ class FileSignatureCreator {
 public:
 	
 	FileSignatureCreator (const char* inFilePath, const char* outFilePath,
-						  uint32_t blockSize, HashFunctionId id);
+						  uint32_t blockSize, HashFunctionId id, const SignatureOptions& options = {});
 	FileSignatureCreator (const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* inFilePath,
 						  const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* outFilePath,
-		                  uint32_t blockSize, HashFunctionId id);
+		                  uint32_t blockSize, HashFunctionId id, const SignatureOptions& options = {});
+	FileSignatureCreator (const char* inFilePath, const char* outFilePath,
+						  const ChunkSizes& chunkSizes, HashFunctionId id, const SignatureOptions& options = {});
+	FileSignatureCreator (const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* inFilePath,
+						  const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* outFilePath,
+						  const ChunkSizes& chunkSizes, HashFunctionId id, const SignatureOptions& options = {});
 	~FileSignatureCreator() = default;
 };
 
+// -------------------------------------------------------------------------- //
+/*
+	FileSignatureUpdater class
+
+	create an object of this class to make the signature of the input file out of the base
+	signature made of its previous version: only the blocks the hint tells to have changed
+	are read and hashed, the digests of the rest are copied, and the block size, the hash
+	function, the format and whether there are weak checksums and block contents are those
+	of the base signature;
+	the input must be of the size it was
+
+	the output path mustn't point to the base signature, otherwise the same as FileSignatureCreator
+
+	may throw:
+	- the same as FileSignatureCreator
+	- std::runtime_error - in case the base signature is invalid or made of content-defined chunks,
+						   or the input size doesn't match it
+ */
+// -------------------------------------------------------------------------- //
+
+class FileSignatureUpdater {
+public:
+
+	FileSignatureUpdater (const char* inFilePath, const char* outFilePath, const char* baseSignaturePath,
+						  const ChangeHint& hint, const SignatureOptions& options = {});
+	FileSignatureUpdater (const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* inFilePath,
+						  const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* outFilePath,
+						  const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* baseSignaturePath,
+						  const ChangeHint& hint, const SignatureOptions& options = {});
+	~FileSignatureUpdater() = default;
+
+	// the one of the base signature
+	HashFunctionId hashFunctionId() const { return m_hashFunctionId; }
+
+private:
+
+	HashFunctionId m_hashFunctionId{ HashFunctionId::CRC32 };
+};
+
+// the first and the last block of a range of blocks
+using block_range_t = std::pair<uint64_t, uint64_t>;
+
+// -------------------------------------------------------------------------- //
+/*
+	VerificationResult struct
+
+	tells whether the file matches the signature, and which of its blocks don't;
+	the ranges of mismatching blocks are given by their first and last blocks, in order,
+	and only hold the ones found before the stop if the verification has stopped early
+ */
+// -------------------------------------------------------------------------- //
+
+struct VerificationResult {
+	HashFunctionId hashFunctionId{ HashFunctionId::CRC32 };
+	uint32_t blockSize{ 0 };
+	bool sizeMatches{ true };
+	bool stoppedEarly{ false };
+	std::vector<block_range_t> mismatches;
+
+	bool passed() const { return sizeMatches && mismatches.empty(); }
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	FileSignatureVerifier class
+
+	create an object of this class to check the input file against an existing signature:
+	the file is hashed with the block size and hash function of the signature the same way
+	FileSignatureCreator does it, and the digests are compared to the ones of the signature
+	as they are ready; the mappedOutput, weakChecksums, sectioned and blockContents options
+	are not applicable
+
+	may throw:
+	- std::invalid_argument - in case the file paths are invalid
+	- std::ios_base::failure - in case of I/O errors
+	- std::runtime_error - in case the signature is invalid or made of content-defined chunks,
+						   or of an internal error, most probably I/O related
+	- std::bad_alloc - in case of memory shortage
+	- std::system_error - in case of thread-related issues or memory mapping errors
+	- std::filesystem_error - in case of the filesystem errors
+ */
+// -------------------------------------------------------------------------- //
+
+class FileSignatureVerifier {
+public:
+
+	FileSignatureVerifier (const char* inFilePath, const char* signaturePath, const SignatureOptions& options = {});
+	FileSignatureVerifier (const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* inFilePath,
+						   const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* signaturePath,
+						   const SignatureOptions& options = {});
+	~FileSignatureVerifier() = default;
+
+	const VerificationResult& result() const { return m_result; }
+
+private:
+
+	VerificationResult m_result;
+};
+
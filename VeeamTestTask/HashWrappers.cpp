@@ -5,6 +5,171 @@
 
 #include "../CryptoPP/md5.h"
 #include "../CryptoPP/crc.h"
+#include "../CryptoPP/blake2.h"
+#include "../CryptoPP/sha.h"
+#include "../CryptoPP/cpu.h"
+
+#include "MD5MultiBuffer.h"
+#include "SHA256MultiBuffer.h"
+#include "XXH3.h"
+#include "BLAKE3.h"
+#include "CRCCombiner.h"
+#include "BlockScan.h"
+
+// the kernel names mirror the runtime dispatch done by CryptoPP itself
+
+// -------------------------------------------------------------------------- //
+/*
+	GenericHashWrapper methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+void GenericHashWrapper::createDigests(const BlockRun* runs, size_t count, size_t blockSize) {
+	assert(blockSize);
+
+	// the runs are split around the blocks whose digests are cached
+
+	m_dataRuns.clear();
+
+	for (auto run = runs; run != runs + count; ++run) {
+		auto digest = run->digests;
+		size_t dataOffset{ 0 };
+
+		for (size_t offset = 0; offset < run->size; offset += blockSize, digest += digestSize()) {
+			auto content = createCachedDigest(run->input + offset, std::min(blockSize, run->size - offset), digest);
+
+			if (run->contents) {
+				run->contents[offset / blockSize] = content;
+			}
+
+			if (content == BlockContent::Data) {
+				continue;
+			}
+
+			if (offset > dataOffset) {
+				m_dataRuns.push_back({ run->input + dataOffset, offset - dataOffset, run->digests + dataOffset / blockSize * digestSize(), nullptr });
+			}
+
+			dataOffset = offset + blockSize;
+		}
+
+		if (run->size > dataOffset) {
+			m_dataRuns.push_back({ run->input + dataOffset, run->size - dataOffset, run->digests + dataOffset / blockSize * digestSize(), nullptr });
+		}
+	}
+
+	if (!m_dataRuns.empty()) {
+		hashRuns(m_dataRuns.data(), m_dataRuns.size(), blockSize);
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+BlockContent GenericHashWrapper::createCachedDigest(const unsigned char* input, size_t size, unsigned char* digest) {
+	// the block is as good as any other block of the same content, so the first one of them is hashed
+
+	if (BlockScan::isZero(input, size)) {
+		auto cached = m_zeroDigests.find(size);
+
+		if (cached == m_zeroDigests.end()) {
+			hash_t zeroDigest(digestSize());
+
+			createDigest(input, size, zeroDigest.data());
+
+			cached = m_zeroDigests.emplace(size, std::move(zeroDigest)).first;
+		}
+
+		std::memcpy(digest, cached->second.data(), cached->second.size());
+
+		return BlockContent::Zeros;
+	}
+
+	if (!m_detectPatterns) {
+		return BlockContent::Data;
+	}
+
+	auto period = BlockScan::findPeriod(input, size, s_maxPatternSize);
+
+	if (!period) {
+		return BlockContent::Data;
+	}
+
+	pattern_key_t key{ size, std::vector<unsigned char>(input, input + period) };
+	auto cached = m_patternDigests.find(key);
+
+	if (cached == m_patternDigests.end()) {
+		if (m_patternDigests.size() == s_maxCachedPatterns) {
+			m_patternDigests.clear();
+		}
+
+		hash_t patternDigest(digestSize());
+
+		createDigest(input, size, patternDigest.data());
+
+		cached = m_patternDigests.emplace(std::move(key), std::move(patternDigest)).first;
+	}
+
+	std::memcpy(digest, cached->second.data(), cached->second.size());
+
+	return BlockContent::Pattern;
+}
+
+// -------------------------------------------------------------------------- //
+
+void GenericHashWrapper::hashRuns(const BlockRun* runs, size_t count, size_t blockSize) {
+	for (auto run = runs; run != runs + count; ++run) {
+		auto digest = run->digests;
+
+		for (size_t offset = 0; offset < run->size; offset += blockSize, digest += digestSize()) {
+			createDigest(run->input + offset, std::min(blockSize, run->size - offset), digest);
+		}
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+namespace {
+
+constexpr unsigned int s_maxLanes{ 16 };
+
+// feeds the full-sized blocks to a multi-buffer kernel the given number at a time,
+// the short last one of the file (if any) goes the regular way
+
+template <class Kernel>
+void hashInLanes (GenericHashWrapper& wrapper, const GenericHashWrapper::BlockRun* runs, size_t count,
+				  size_t blockSize, unsigned int lanes, Kernel kernel) {
+	assert(lanes && lanes <= s_maxLanes);
+
+	const unsigned char* inputs[s_maxLanes];
+	unsigned char* digests[s_maxLanes];
+	unsigned int pending{ 0 };
+
+	for (auto run = runs; run != runs + count; ++run) {
+		auto digest = run->digests;
+
+		for (size_t offset = 0; offset < run->size; offset += blockSize, digest += wrapper.digestSize()) {
+			if (run->size - offset < blockSize) {
+				wrapper.createDigest(run->input + offset, run->size - offset, digest);
+
+				continue;
+			}
+
+			inputs[pending] = run->input + offset;
+			digests[pending] = digest;
+
+			if (++pending == lanes) {
+				kernel(inputs, blockSize, digests, pending);
+				pending = 0;
+			}
+		}
+	}
+
+	if (pending) {
+		kernel(inputs, blockSize, digests, pending);
+	}
+}
+
+}
 
 // -------------------------------------------------------------------------- //
 /*
@@ -19,15 +184,80 @@ public:
 
 	MD5HashWrapper() = default;
 	
-	void createDigest(const buffer_t& input, hash_t& hash) override {
-		assert(hash.size() == m_hasher.DigestSize());
+	unsigned int digestSize() const override { return CryptoPP::Weak::MD5::DIGESTSIZE; }
+	const char* kernelName() const override { return m_multiBuffer ? "AVX2 multi-buffer" : "C++"; }
 
-		m_hasher.CalculateDigest(hash.data(), input.data(), input.size());
+	void createDigest(const unsigned char* input, size_t size, unsigned char* digest) override {
+		m_hasher.CalculateDigest(digest, input, size);
+	}
+
+	unsigned int preferredBatchSize() const override { return m_multiBuffer ? MD5MultiBuffer::s_lanes : 1; }
+
+protected:
+
+	void hashRuns(const BlockRun* runs, size_t count, size_t blockSize) override {
+		if (m_multiBuffer) {
+			hashInLanes(*this, runs, count, blockSize, MD5MultiBuffer::s_lanes, &MD5MultiBuffer::hash);
+		} else {
+			GenericHashWrapper::hashRuns(runs, count, blockSize);
+		}
 	}
 
 private:
 
 	CryptoPP::Weak::MD5 m_hasher;
+	bool m_multiBuffer{ MD5MultiBuffer::isSupported() };
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	CRCHashWrapper class
+
+	the part the CRC32 and CRC32C wrappers have in common: a block may be split
+	into ranges of any size, whose CRCs are then combined into the CRC of the block
+ */
+// -------------------------------------------------------------------------- //
+
+class CRCHashWrapper : public GenericHashWrapper {
+public:
+
+	explicit CRCHashWrapper(const CRCCombiner& combiner) : m_combiner(combiner) {}
+
+	size_t partSize(size_t size, unsigned int maxParts) const override {
+		// the parts are kept whole pages long, which suits both the buffers and the mapped windows
+		const size_t granularity = 4096;
+
+		return (size / maxParts + granularity) / granularity * granularity;
+	}
+
+	unsigned int partResultSize() const override { return s_crcSize; }
+
+	void hashPart(const unsigned char* part, size_t size, size_t, unsigned char* result) override {
+		createDigest(part, size, result);
+	}
+
+	void combineParts(const unsigned char* results, size_t count, size_t partSize, size_t size, unsigned char* digest) override {
+		auto crc = readCRC(results);
+
+		for (size_t i = 1; i < count; ++i) {
+			crc = m_combiner.combine(crc, readCRC(results + i * s_crcSize), std::min(partSize, size - i * partSize));
+		}
+
+		for (unsigned int i = 0; i < s_crcSize; ++i) {
+			digest[i] = static_cast<unsigned char>(crc >> (i * 8));
+		}
+	}
+
+private:
+
+	static constexpr unsigned int s_crcSize{ 4 };
+
+	// the digests are the little-endian CRC values
+	static uint32_t readCRC(const unsigned char* digest) {
+		return digest[0] | (digest[1] << 8) | (digest[2] << 16) | (static_cast<uint32_t>(digest[3]) << 24);
+	}
+
+	const CRCCombiner& m_combiner;
 };
 
 // -------------------------------------------------------------------------- //
@@ -38,22 +268,267 @@ private:
  */
 // -------------------------------------------------------------------------- //
 
-class CRC32HashWrapper : public GenericHashWrapper {
+class CRC32HashWrapper : public CRCHashWrapper {
 public:
 
-	CRC32HashWrapper() = default;
+	CRC32HashWrapper() : CRCHashWrapper(combiner()) {}
 	
-	void createDigest(const buffer_t& input, hash_t& hash) override {
-		assert(hash.size() == m_hasher.DigestSize());
+	unsigned int digestSize() const override { return CryptoPP::CRC32::DIGESTSIZE; }
+
+	const char* kernelName() const override {
+#if CRYPTOPP_ARM_CRC32_AVAILABLE
+		if (CryptoPP::HasCRC32()) {
+			return "ARMv8 CRC32";
+		}
+#endif
+#if CRYPTOPP_CLMUL_AVAILABLE
+		if (CryptoPP::HasCLMUL()) {
+			return "PCLMULQDQ";
+		}
+#endif
+		return "C++";
+	}
 
-		m_hasher.CalculateDigest(hash.data(), input.data(), input.size());
+	void createDigest(const unsigned char* input, size_t size, unsigned char* digest) override {
+		m_hasher.CalculateDigest(digest, input, size);
 	}
 
 private:
 
+	static const CRCCombiner& combiner() {
+		static const CRCCombiner s_combiner{ CRCCombiner::s_crc32Polynomial };
+
+		return s_combiner;
+	}
+
 	CryptoPP::CRC32 m_hasher;
 };
 
+// -------------------------------------------------------------------------- //
+/*
+	CRC32CHashWrapper class
+
+	incapsulation of the CRC32C (Castagnoli) algorithm implementation
+ */
+// -------------------------------------------------------------------------- //
+
+class CRC32CHashWrapper : public CRCHashWrapper {
+public:
+
+	CRC32CHashWrapper() : CRCHashWrapper(combiner()) {}
+	
+	unsigned int digestSize() const override { return CryptoPP::CRC32C::DIGESTSIZE; }
+
+	const char* kernelName() const override {
+#if CRYPTOPP_SSE42_AVAILABLE
+		if (CryptoPP::HasSSE42()) {
+			return "SSE4.2";
+		}
+#elif CRYPTOPP_ARM_CRC32_AVAILABLE
+		if (CryptoPP::HasCRC32()) {
+			return "ARMv8 CRC32";
+		}
+#endif
+		return "C++";
+	}
+
+	void createDigest(const unsigned char* input, size_t size, unsigned char* digest) override {
+		m_hasher.CalculateDigest(digest, input, size);
+	}
+
+private:
+
+	static const CRCCombiner& combiner() {
+		static const CRCCombiner s_combiner{ CRCCombiner::s_crc32cPolynomial };
+
+		return s_combiner;
+	}
+
+	CryptoPP::CRC32C m_hasher;
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	BLAKE2HashWrapper class
+
+	incapsulation of the BLAKE2b and BLAKE2s algorithm implementations,
+	both producing the digests of their default sizes
+ */
+// -------------------------------------------------------------------------- //
+
+template <class Hasher>
+class BLAKE2HashWrapper : public GenericHashWrapper {
+public:
+
+	BLAKE2HashWrapper() = default;
+	
+	unsigned int digestSize() const override { return Hasher::DIGESTSIZE; }
+
+	const char* kernelName() const override {
+#if CRYPTOPP_SSE41_AVAILABLE
+		if (CryptoPP::HasSSE41()) {
+			return "SSE4.1";
+		}
+#endif
+#if CRYPTOPP_ARM_NEON_AVAILABLE
+		if (CryptoPP::HasNEON()) {
+			return "NEON";
+		}
+#endif
+		return "C++";
+	}
+
+	void createDigest(const unsigned char* input, size_t size, unsigned char* digest) override {
+		m_hasher.CalculateDigest(digest, input, size);
+	}
+
+private:
+
+	Hasher m_hasher;
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	SHA256HashWrapper class
+
+	incapsulation of the SHA-256 algorithm implementation
+ */
+// -------------------------------------------------------------------------- //
+
+class SHA256HashWrapper : public GenericHashWrapper {
+public:
+
+	SHA256HashWrapper() = default;
+	
+	unsigned int digestSize() const override { return CryptoPP::SHA256::DIGESTSIZE; }
+
+	const char* kernelName() const override {
+		if (m_lanes) {
+			return m_lanes == 16 ? "AVX-512 multi-buffer" : "AVX2 multi-buffer";
+		}
+#if CRYPTOPP_SHANI_AVAILABLE
+		if (CryptoPP::HasSHA()) {
+			return "SHA-NI";
+		}
+#endif
+
+#if CRYPTOPP_ARM_SHA_AVAILABLE
+		if (CryptoPP::HasSHA2()) {
+			return "ARMv8 SHA2";
+		}
+#endif
+#if CRYPTOPP_SSE2_ASM_AVAILABLE
+		if (CryptoPP::HasSSE2()) {
+			return "SSE2";
+		}
+#endif
+		return "C++";
+	}
+
+	void createDigest(const unsigned char* input, size_t size, unsigned char* digest) override {
+		m_hasher.CalculateDigest(digest, input, size);
+	}
+
+	unsigned int preferredBatchSize() const override { return m_lanes ? m_lanes : 1; }
+
+protected:
+
+	void hashRuns(const BlockRun* runs, size_t count, size_t blockSize) override {
+		if (m_lanes) {
+			hashInLanes(*this, runs, count, blockSize, m_lanes, &SHA256MultiBuffer::hash);
+		} else {
+			GenericHashWrapper::hashRuns(runs, count, blockSize);
+		}
+	}
+
+private:
+
+	// the multi-buffer kernels are meant for the CPUs lacking the SHA extensions,
+	// the ones having them are left to CryptoPP
+
+	static unsigned int multiBufferLanes() {
+#if CRYPTOPP_SHANI_AVAILABLE
+		if (CryptoPP::HasSHA()) {
+			return 0;
+		}
+#endif
+		return SHA256MultiBuffer::lanes();
+	}
+
+	CryptoPP::SHA256 m_hasher;
+	unsigned int m_lanes{ multiBufferLanes() };
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	XXH3HashWrapper class
+
+	incapsulation of the 64-bit and the 128-bit flavours of the XXH3 algorithm
+ */
+// -------------------------------------------------------------------------- //
+
+class XXH3HashWrapper : public GenericHashWrapper {
+public:
+
+	explicit XXH3HashWrapper (bool wide) : m_wide{ wide } {}
+
+	unsigned int digestSize() const override { return m_wide ? XXH3::s_digestSize128 : XXH3::s_digestSize64; }
+	const char* kernelName() const override { return XXH3::kernelName(); }
+
+	void createDigest(const unsigned char* input, size_t size, unsigned char* digest) override {
+		if (m_wide) {
+			XXH3::hash128(input, size, digest);
+		} else {
+			XXH3::hash64(input, size, digest);
+		}
+	}
+
+private:
+
+	bool m_wide;
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	BLAKE3HashWrapper class
+
+	the parts a block is split into are subtrees of a power-of-two number of chunks
+ */
+// -------------------------------------------------------------------------- //
+
+class BLAKE3HashWrapper : public GenericHashWrapper {
+public:
+
+	unsigned int digestSize() const override { return BLAKE3::s_digestSize; }
+	const char* kernelName() const override { return BLAKE3::kernelName(); }
+
+	void createDigest(const unsigned char* input, size_t size, unsigned char* digest) override {
+		BLAKE3::hash(input, size, digest);
+	}
+
+	size_t partSize(size_t size, unsigned int maxParts) const override {
+		auto chunks = (size + BLAKE3::s_chunkSize - 1) / BLAKE3::s_chunkSize;
+		auto chunksWanted = (chunks + maxParts - 1) / maxParts;
+		size_t partChunks = 1;
+
+		while (partChunks < chunksWanted) {
+			partChunks <<= 1;
+		}
+
+		return partChunks * BLAKE3::s_chunkSize;
+	}
+
+	unsigned int partResultSize() const override { return BLAKE3::s_chainingValueSize; }
+
+	void hashPart(const unsigned char* part, size_t size, size_t offset, unsigned char* result) override {
+		BLAKE3::hashPart(part, size, offset / BLAKE3::s_chunkSize, result);
+	}
+
+	void combineParts(const unsigned char* results, size_t count, size_t, size_t, unsigned char* digest) override {
+		BLAKE3::combineParts(results, count, digest);
+	}
+};
+
 // -------------------------------------------------------------------------- //
 /*
 	HashWrapperFactory methods implementation
@@ -64,6 +539,13 @@ HashWrapperPtr HashWrapperFactory::createHashWrapper(HashFunctionId id) {
 	switch (id) {
 	case HashFunctionId::CRC32: return HashWrapperPtr(new CRC32HashWrapper{});
 	case HashFunctionId::MD5: return HashWrapperPtr(new MD5HashWrapper{});
+	case HashFunctionId::CRC32C: return HashWrapperPtr(new CRC32CHashWrapper{});
+	case HashFunctionId::BLAKE2b: return HashWrapperPtr(new BLAKE2HashWrapper<CryptoPP::BLAKE2b>{});
+	case HashFunctionId::BLAKE2s: return HashWrapperPtr(new BLAKE2HashWrapper<CryptoPP::BLAKE2s>{});
+	case HashFunctionId::SHA256: return HashWrapperPtr(new SHA256HashWrapper{});
+	case HashFunctionId::XXH3: return HashWrapperPtr(new XXH3HashWrapper{ false });
+	case HashFunctionId::XXH128: return HashWrapperPtr(new XXH3HashWrapper{ true });
+	case HashFunctionId::BLAKE3: return HashWrapperPtr(new BLAKE3HashWrapper{});
 	default: assert(false); throw std::runtime_error("Hashing algorithm not supported");
 	}
 }
@@ -78,6 +560,17 @@ unsigned int HashTraits::digestSize(HashFunctionId id) {
 	switch (id) {
 	case HashFunctionId::CRC32: return CryptoPP::CRC32::DIGESTSIZE;
 	case HashFunctionId::MD5: return CryptoPP::Weak::MD5::DIGESTSIZE;
+	case HashFunctionId::CRC32C: return CryptoPP::CRC32C::DIGESTSIZE;
+	case HashFunctionId::BLAKE2b: return CryptoPP::BLAKE2b::DIGESTSIZE;
+	case HashFunctionId::BLAKE2s: return CryptoPP::BLAKE2s::DIGESTSIZE;
+	case HashFunctionId::SHA256: return CryptoPP::SHA256::DIGESTSIZE;
+	case HashFunctionId::XXH3: return XXH3::s_digestSize64;
+	case HashFunctionId::XXH128: return XXH3::s_digestSize128;
+	case HashFunctionId::BLAKE3: return BLAKE3::s_digestSize;
 	default: assert(false); throw std::runtime_error("Hashing algorithm not supported");
 	}
+}
+
+const char* HashTraits::kernelName(HashFunctionId id) {
+	return HashWrapperFactory::createHashWrapper(id)->kernelName();
 }
\ No newline at end of file
@@ -16,7 +16,97 @@ public:
 	
 	virtual ~GenericHashWrapper () = default;
 
-	virtual void createDigest (const buffer_t& input, hash_t& hash) = 0;	
+	virtual unsigned int digestSize() const = 0;
+
+	// the implementation picked for the current CPU, for information purposes
+	virtual const char* kernelName() const = 0;
+
+	virtual void createDigest (const unsigned char* input, size_t size, unsigned char* digest) = 0;
+
+	// a run of consecutive blocks (the last one may be shorter than the others),
+	// and the place for their digests to be put one after another, as well as
+	// the one for what the blocks are made of, if that's wanted
+
+	struct BlockRun {
+		const unsigned char* input;
+		size_t size;
+		unsigned char* digests;
+		BlockContent* contents;
+	};
+
+	// hashes several independent runs of blocks, the blocks of a uniform content among them
+	// get the digests cached for them (see createCachedDigest()), and the rest go to hashRuns()
+
+	void createDigests (const BlockRun* runs, size_t count, size_t blockSize);
+
+	void createDigests (const unsigned char* input, size_t size, size_t blockSize, unsigned char* digests) {
+		BlockRun run{ input, size, digests, nullptr };
+
+		createDigests(&run, 1, blockSize);
+	}
+
+	// the number of blocks worth passing to createDigests() at once
+	virtual unsigned int preferredBatchSize() const { return 1; }
+
+	// the hashing algorithms able to hash the parts of a block independently and to make
+	// the digest out of the results let a large block be shared among several threads:
+	// partSize() tells the size of the parts so that there are no more than `maxParts` of them,
+	// all of the same size except for the last one, or zero if the block can't be split;
+	// the rest of them throw std::logic_error when asked for the parts anyway
+
+	virtual size_t partSize (size_t /* size */, unsigned int /* maxParts */) const { return 0; }
+	virtual unsigned int partResultSize() const { return 0; }
+
+	// `offset` is where the part begins in its block
+	virtual void hashPart (const unsigned char* /* part */, size_t /* size */, size_t /* offset */, unsigned char* /* result */) {
+		throw std::logic_error("The hash method can't hash the parts of a block");
+	}
+
+	virtual void combineParts (const unsigned char* /* results */, size_t /* count */, size_t /* partSize */, size_t /* size */,
+							   unsigned char* /* digest */) {
+		throw std::logic_error("The hash method can't hash the parts of a block");
+	}
+
+	void createDigest (const unsigned char* input, size_t size, hash_t& hash) {
+		assert(hash.size() == digestSize());
+
+		createDigest(input, size, hash.data());
+	}
+
+	void createDigest (const buffer_t& input, hash_t& hash) { createDigest(input.data(), input.size(), hash); }
+
+	// puts the digest of the block in place and tells so if the block is made of zeros or,
+	// if the pattern detection is on, of a short pattern repeated; the digest is only computed
+	// once for every block size and pattern, and the rest of the blocks are left as they are
+
+	BlockContent createCachedDigest (const unsigned char* input, size_t size, unsigned char* digest);
+
+	// the patterns are up to s_maxPatternSize bytes long, which covers a repeated disk sector
+	void detectPatterns (bool on) { m_detectPatterns = on; }
+
+	static constexpr size_t s_maxPatternSize{ 512 };
+
+protected:
+
+	// the hashing algorithms able to process several blocks at a time may override it
+
+	virtual void hashRuns (const BlockRun* runs, size_t count, size_t blockSize);
+
+private:
+
+	// the cache of the pattern digests is emptied once it grows that big,
+	// there's little use for it if the patterns keep changing
+
+	static constexpr size_t s_maxCachedPatterns{ 256 };
+
+	// the patterns are keyed by the size of the block and the pattern itself
+	using pattern_key_t = std::pair<size_t, std::vector<unsigned char>>;
+
+	std::map<size_t, hash_t> m_zeroDigests;
+	std::map<pattern_key_t, hash_t> m_patternDigests;
+	bool m_detectPatterns{ false };
+
+	std::vector<BlockRun> m_dataRuns;
 };
 
 using HashWrapperPtr = std::unique_ptr<GenericHashWrapper>;
@@ -47,4 +137,5 @@ class HashTraits {
 public:
 
 	static unsigned int digestSize(HashFunctionId id);
+	static const char* kernelName(HashFunctionId id);
 };
\ No newline at end of file
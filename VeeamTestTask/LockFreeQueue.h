@@ -0,0 +1,195 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+
+// -------------------------------------------------------------------------- //
+/*
+	BoundedQueue class
+
+	a lock-free multi-producer multi-consumer FIFO queue with the capacity fixed at construction
+	(rounded up to a power of two), every slot carries a sequence number telling whether it's
+	ready to be written to or read from at the current lap
+
+	the slots are allocated once and reused, so T should be cheap to move
+ */
+// -------------------------------------------------------------------------- //
+
+template <class T>
+class BoundedQueue {
+public:
+
+	explicit BoundedQueue (size_t capacity) {
+		size_t size{ 2 };
+
+		while (size < capacity) {
+			size <<= 1;
+		}
+
+		m_slots.reset(new Slot[size]);
+		m_mask = size - 1;
+
+		for (size_t i = 0; i < size; ++i) {
+			m_slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	BoundedQueue (const BoundedQueue&) = delete;
+	BoundedQueue& operator= (const BoundedQueue&) = delete;
+
+	size_t capacity() const { return m_mask + 1; }
+
+	// the value is only moved from if there's room in the queue
+	bool tryPush (T& value) {
+		auto pos = m_tail.load(std::memory_order_relaxed);
+		Slot* slot;
+
+		while (true) {
+			slot = &m_slots[pos & m_mask];
+
+			auto seq = slot->sequence.load(std::memory_order_acquire);
+			auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+			if (!diff) {
+				if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (diff < 0) {
+				return false;
+			} else {
+				pos = m_tail.load(std::memory_order_relaxed);
+			}
+		}
+
+		slot->value = std::move(value);
+		slot->sequence.store(pos + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	bool tryPop (T& value) {
+		auto pos = m_head.load(std::memory_order_relaxed);
+		Slot* slot;
+
+		while (true) {
+			slot = &m_slots[pos & m_mask];
+
+			auto seq = slot->sequence.load(std::memory_order_acquire);
+			auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+
+			if (!diff) {
+				if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (diff < 0) {
+				return false;
+			} else {
+				pos = m_head.load(std::memory_order_relaxed);
+			}
+		}
+
+		value = std::move(slot->value);
+		slot->sequence.store(pos + m_mask + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// only approximate when the queue is being modified concurrently
+	size_t size() const {
+		auto head = m_head.load(std::memory_order_relaxed);
+		auto tail = m_tail.load(std::memory_order_relaxed);
+
+		return tail > head ? tail - head : 0;
+	}
+
+private:
+
+	struct Slot {
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	std::unique_ptr<Slot[]> m_slots;
+	size_t m_mask{ 0 };
+
+	// the producers and the consumers mustn't share a cache line
+	alignas(64) std::atomic<size_t> m_head{ 0 };
+	alignas(64) std::atomic<size_t> m_tail{ 0 };
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	WaitPoint class
+
+	lets a thread wait for a condition to become true without any locking on the signalling side
+	as long as nobody is waiting: the waiter spins for a while first, and then parks on
+	a condition variable, announcing itself so that the signalling side knows to wake it up
+
+	the condition must be made true before notify() is called
+ */
+// -------------------------------------------------------------------------- //
+
+class WaitPoint {
+
+	static constexpr int s_spinCount{ 128 };
+	static constexpr auto s_parkTimeout{ std::chrono::milliseconds{100} };
+
+public:
+
+	template <class Predicate>
+	void wait (Predicate pred) {
+		for (int i = 0; i < s_spinCount; ++i) {
+			if (pred()) {
+				return;
+			}
+
+			std::this_thread::yield();
+		}
+
+		m_waiters.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		{
+			std::unique_lock<std::mutex> ul{ m_guard };
+
+			// the timeout is merely a safety net, a notification isn't supposed to get lost
+			while (!m_cv.wait_for(ul, s_parkTimeout, pred));
+		}
+
+		m_waiters.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	void notifyOne() {
+		if (hasWaiters()) {
+			std::lock_guard<std::mutex> lg{ m_guard };
+
+			m_cv.notify_one();
+		}
+	}
+
+	void notifyAll() {
+		if (hasWaiters()) {
+			std::lock_guard<std::mutex> lg{ m_guard };
+
+			m_cv.notify_all();
+		}
+	}
+
+private:
+
+	bool hasWaiters() {
+		// pairs with the increment of the waiters, so that either the waiter sees
+		// the condition satisfied or the notifier sees the waiter
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		return m_waiters.load(std::memory_order_relaxed) > 0;
+	}
+
+	std::atomic<int> m_waiters{ 0 };
+	std::mutex m_guard;
+	std::condition_variable m_cv;
+};
@@ -0,0 +1,204 @@
+#include "stdafx.h"
+#include "MD5MultiBuffer.h"
+#include "CpuFeatures.h"
+#include "Simd.h"
+
+#ifdef SIMD_X86
+
+namespace {
+
+constexpr size_t s_chunkSize{ 64 };
+
+// runs a 64-byte chunk of every lane at the given offset through the compression function
+
+SIMD_TARGET_AVX2 void transform (__m256i state[4], const unsigned char* const lanes[], size_t offset) {
+	__m256i w[16];
+
+	for (int half = 0; half < 2; ++half) {
+		for (unsigned int j = 0; j < MD5MultiBuffer::s_lanes; ++j) {
+			w[half * 8 + j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes[j] + offset + half * 32));
+		}
+
+		transpose8x8(w + half * 8);
+	}
+
+	const __m256i ones = _mm256_set1_epi32(-1);
+
+	__m256i a = state[0];
+	__m256i b = state[1];
+	__m256i c = state[2];
+	__m256i d = state[3];
+
+#define F(x, y, z) _mm256_xor_si256(z, _mm256_and_si256(x, _mm256_xor_si256(y, z)))
+#define G(x, y, z) _mm256_xor_si256(y, _mm256_and_si256(z, _mm256_xor_si256(x, y)))
+#define H(x, y, z) _mm256_xor_si256(x, _mm256_xor_si256(y, z))
+#define I(x, y, z) _mm256_xor_si256(y, _mm256_or_si256(x, _mm256_xor_si256(z, ones)))
+
+#define MD5_STEP(f, a, b, c, d, k, s, t) \
+	a = _mm256_add_epi32(a, _mm256_add_epi32(f(b, c, d), _mm256_add_epi32(w[k], _mm256_set1_epi32(static_cast<int>(t))))); \
+	a = _mm256_add_epi32(b, _mm256_or_si256(_mm256_slli_epi32(a, s), _mm256_srli_epi32(a, 32 - s)))
+
+	MD5_STEP(F, a, b, c, d,  0,  7, 0xd76aa478);
+	MD5_STEP(F, d, a, b, c,  1, 12, 0xe8c7b756);
+	MD5_STEP(F, c, d, a, b,  2, 17, 0x242070db);
+	MD5_STEP(F, b, c, d, a,  3, 22, 0xc1bdceee);
+	MD5_STEP(F, a, b, c, d,  4,  7, 0xf57c0faf);
+	MD5_STEP(F, d, a, b, c,  5, 12, 0x4787c62a);
+	MD5_STEP(F, c, d, a, b,  6, 17, 0xa8304613);
+	MD5_STEP(F, b, c, d, a,  7, 22, 0xfd469501);
+	MD5_STEP(F, a, b, c, d,  8,  7, 0x698098d8);
+	MD5_STEP(F, d, a, b, c,  9, 12, 0x8b44f7af);
+	MD5_STEP(F, c, d, a, b, 10, 17, 0xffff5bb1);
+	MD5_STEP(F, b, c, d, a, 11, 22, 0x895cd7be);
+	MD5_STEP(F, a, b, c, d, 12,  7, 0x6b901122);
+	MD5_STEP(F, d, a, b, c, 13, 12, 0xfd987193);
+	MD5_STEP(F, c, d, a, b, 14, 17, 0xa679438e);
+	MD5_STEP(F, b, c, d, a, 15, 22, 0x49b40821);
+
+	MD5_STEP(G, a, b, c, d,  1,  5, 0xf61e2562);
+	MD5_STEP(G, d, a, b, c,  6,  9, 0xc040b340);
+	MD5_STEP(G, c, d, a, b, 11, 14, 0x265e5a51);
+	MD5_STEP(G, b, c, d, a,  0, 20, 0xe9b6c7aa);
+	MD5_STEP(G, a, b, c, d,  5,  5, 0xd62f105d);
+	MD5_STEP(G, d, a, b, c, 10,  9, 0x02441453);
+	MD5_STEP(G, c, d, a, b, 15, 14, 0xd8a1e681);
+	MD5_STEP(G, b, c, d, a,  4, 20, 0xe7d3fbc8);
+	MD5_STEP(G, a, b, c, d,  9,  5, 0x21e1cde6);
+	MD5_STEP(G, d, a, b, c, 14,  9, 0xc33707d6);
+	MD5_STEP(G, c, d, a, b,  3, 14, 0xf4d50d87);
+	MD5_STEP(G, b, c, d, a,  8, 20, 0x455a14ed);
+	MD5_STEP(G, a, b, c, d, 13,  5, 0xa9e3e905);
+	MD5_STEP(G, d, a, b, c,  2,  9, 0xfcefa3f8);
+	MD5_STEP(G, c, d, a, b,  7, 14, 0x676f02d9);
+	MD5_STEP(G, b, c, d, a, 12, 20, 0x8d2a4c8a);
+
+	MD5_STEP(H, a, b, c, d,  5,  4, 0xfffa3942);
+	MD5_STEP(H, d, a, b, c,  8, 11, 0x8771f681);
+	MD5_STEP(H, c, d, a, b, 11, 16, 0x6d9d6122);
+	MD5_STEP(H, b, c, d, a, 14, 23, 0xfde5380c);
+	MD5_STEP(H, a, b, c, d,  1,  4, 0xa4beea44);
+	MD5_STEP(H, d, a, b, c,  4, 11, 0x4bdecfa9);
+	MD5_STEP(H, c, d, a, b,  7, 16, 0xf6bb4b60);
+	MD5_STEP(H, b, c, d, a, 10, 23, 0xbebfbc70);
+	MD5_STEP(H, a, b, c, d, 13,  4, 0x289b7ec6);
+	MD5_STEP(H, d, a, b, c,  0, 11, 0xeaa127fa);
+	MD5_STEP(H, c, d, a, b,  3, 16, 0xd4ef3085);
+	MD5_STEP(H, b, c, d, a,  6, 23, 0x04881d05);
+	MD5_STEP(H, a, b, c, d,  9,  4, 0xd9d4d039);
+	MD5_STEP(H, d, a, b, c, 12, 11, 0xe6db99e5);
+	MD5_STEP(H, c, d, a, b, 15, 16, 0x1fa27cf8);
+	MD5_STEP(H, b, c, d, a,  2, 23, 0xc4ac5665);
+
+	MD5_STEP(I, a, b, c, d,  0,  6, 0xf4292244);
+	MD5_STEP(I, d, a, b, c,  7, 10, 0x432aff97);
+	MD5_STEP(I, c, d, a, b, 14, 15, 0xab9423a7);
+	MD5_STEP(I, b, c, d, a,  5, 21, 0xfc93a039);
+	MD5_STEP(I, a, b, c, d, 12,  6, 0x655b59c3);
+	MD5_STEP(I, d, a, b, c,  3, 10, 0x8f0ccc92);
+	MD5_STEP(I, c, d, a, b, 10, 15, 0xffeff47d);
+	MD5_STEP(I, b, c, d, a,  1, 21, 0x85845dd1);
+	MD5_STEP(I, a, b, c, d,  8,  6, 0x6fa87e4f);
+	MD5_STEP(I, d, a, b, c, 15, 10, 0xfe2ce6e0);
+	MD5_STEP(I, c, d, a, b,  6, 15, 0xa3014314);
+	MD5_STEP(I, b, c, d, a, 13, 21, 0x4e0811a1);
+	MD5_STEP(I, a, b, c, d,  4,  6, 0xf7537e82);
+	MD5_STEP(I, d, a, b, c, 11, 10, 0xbd3af235);
+	MD5_STEP(I, c, d, a, b,  2, 15, 0x2ad7d2bb);
+	MD5_STEP(I, b, c, d, a,  9, 21, 0xeb86d391);
+
+#undef MD5_STEP
+#undef F
+#undef G
+#undef H
+#undef I
+
+	state[0] = _mm256_add_epi32(state[0], a);
+	state[1] = _mm256_add_epi32(state[1], b);
+	state[2] = _mm256_add_epi32(state[2], c);
+	state[3] = _mm256_add_epi32(state[3], d);
+}
+
+SIMD_TARGET_AVX2 void hashAVX2 (const unsigned char* const lanes[], size_t length, unsigned char* const digests[], unsigned int count) {
+	__m256i state[4] = {
+		_mm256_set1_epi32(0x67452301),
+		_mm256_set1_epi32(static_cast<int>(0xefcdab89)),
+		_mm256_set1_epi32(static_cast<int>(0x98badcfe)),
+		_mm256_set1_epi32(0x10325476)
+	};
+
+	auto fullChunks = length / s_chunkSize;
+
+	for (size_t i = 0; i < fullChunks; ++i) {
+		transform(state, lanes, i * s_chunkSize);
+	}
+
+	// the padding and the message length in bits take one or two more chunks
+
+	unsigned char tails[MD5MultiBuffer::s_lanes][2 * s_chunkSize];
+	const unsigned char* tailLanes[MD5MultiBuffer::s_lanes];
+
+	auto rest = length % s_chunkSize;
+	auto tailSize = rest < s_chunkSize - sizeof(uint64_t) ? s_chunkSize : 2 * s_chunkSize;
+	uint64_t bitLength = static_cast<uint64_t>(length) * 8;
+
+	for (unsigned int j = 0; j < MD5MultiBuffer::s_lanes; ++j) {
+		std::memcpy(tails[j], lanes[j] + fullChunks * s_chunkSize, rest);
+		tails[j][rest] = 0x80;
+		std::memset(tails[j] + rest + 1, 0, tailSize - rest - 1 - sizeof(bitLength));
+		std::memcpy(tails[j] + tailSize - sizeof(bitLength), &bitLength, sizeof(bitLength));
+
+		tailLanes[j] = tails[j];
+	}
+
+	for (size_t offset = 0; offset < tailSize; offset += s_chunkSize) {
+		transform(state, tailLanes, offset);
+	}
+
+	uint32_t words[4][MD5MultiBuffer::s_lanes];
+
+	for (int i = 0; i < 4; ++i) {
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(words[i]), state[i]);
+	}
+
+	for (unsigned int j = 0; j < count; ++j) {
+		for (int i = 0; i < 4; ++i) {
+			std::memcpy(digests[j] + i * sizeof(uint32_t), &words[i][j], sizeof(uint32_t));
+		}
+	}
+}
+
+}
+
+#endif
+
+// -------------------------------------------------------------------------- //
+/*
+	MD5MultiBuffer methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+bool MD5MultiBuffer::isSupported() {
+#ifdef SIMD_X86
+	return CpuFeatures::hasAVX2();
+#else
+	return false;
+#endif
+}
+
+// -------------------------------------------------------------------------- //
+
+void MD5MultiBuffer::hash (const unsigned char* const inputs[], size_t length, unsigned char* const digests[], unsigned int count) {
+	assert(isSupported() && count >= 1 && count <= s_lanes);
+
+#ifdef SIMD_X86
+	// the spare lanes just repeat the last input, their digests are thrown away
+
+	const unsigned char* lanes[s_lanes];
+
+	for (unsigned int j = 0; j < s_lanes; ++j) {
+		lanes[j] = inputs[j < count ? j : count - 1];
+	}
+
+	hashAVX2(lanes, length, digests, count);
+#endif
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+// -------------------------------------------------------------------------- //
+/*
+	MD5MultiBuffer class
+
+	MD5 is serial within a single message, so rather than speeding up a single digest
+	several independent messages of the same length are hashed in lockstep,
+	each one in its own 32-bit lane of the AVX2 registers
+
+	the digests are identical to the ones of the regular MD5 implementation
+ */
+// -------------------------------------------------------------------------- //
+
+class MD5MultiBuffer {
+public:
+
+	static constexpr unsigned int s_lanes{ 8 };
+
+	static bool isSupported();
+
+	// hashes from 1 to s_lanes inputs of the given length, the digests are 16 bytes each
+	static void hash (const unsigned char* const inputs[], size_t length, unsigned char* const digests[], unsigned int count);
+};
@@ -0,0 +1,1100 @@
+#include "stdafx.h"
+#include "PlatformIO.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define HAS_IO_URING 1
+#endif
+#endif
+
+#include <algorithm>
+#include <numeric>
+#include <system_error>
+
+namespace {
+
+[[noreturn]] void throwLastError (const char* what) {
+#ifdef _WIN32
+	throw std::system_error(static_cast<int>(::GetLastError()), std::system_category(), what);
+#else
+	throw std::system_error(errno, std::system_category(), what);
+#endif
+}
+
+[[noreturn]] void throwUnexpectedEof() {
+	throw std::runtime_error("Unexpected end of the input file");
+}
+
+#ifdef _WIN32
+
+HANDLE openForReading (const path& filePath, DWORD flags) {
+	auto handle = ::CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+
+	if (handle == INVALID_HANDLE_VALUE) {
+		throwLastError((flags & FILE_FLAG_NO_BUFFERING) ? "Failed to open the input file for the unbuffered I/O"
+														: "Failed to open the input file");
+	}
+
+	return handle;
+}
+
+uint64_t fileSizeOf (HANDLE handle) {
+	LARGE_INTEGER size;
+
+	if (!::GetFileSizeEx(handle, &size)) {
+		auto error = ::GetLastError();
+
+		::CloseHandle(handle);
+
+		throw std::system_error(static_cast<int>(error), std::system_category(), "Failed to get the file size");
+	}
+
+	return static_cast<uint64_t>(size.QuadPart);
+}
+
+#else
+
+int openForReading (const path& filePath, bool unbuffered) {
+	int flags = O_RDONLY;
+
+#ifdef O_DIRECT
+	if (unbuffered) {
+		flags |= O_DIRECT;
+	}
+#endif
+
+	int fd = ::open(filePath.c_str(), flags);
+
+	if (fd < 0) {
+		throwLastError(unbuffered ? "Failed to open the input file for the unbuffered I/O" : "Failed to open the input file");
+	}
+
+#if !defined(O_DIRECT) && defined(F_NOCACHE)
+	if (unbuffered) {
+		::fcntl(fd, F_NOCACHE, 1);
+	}
+#endif
+
+	return fd;
+}
+
+uint64_t fileSizeOf (int fd) {
+	struct stat st;
+
+	if (::fstat(fd, &st) < 0) {
+		auto error = errno;
+
+		::close(fd);
+
+		throw std::system_error(error, std::system_category(), "Failed to get the file size");
+	}
+
+	return static_cast<uint64_t>(st.st_size);
+}
+
+#endif
+
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	MappedWindow methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+MappedWindow::MappedWindow (void* viewBase, size_t viewSize, size_t dataOffset)
+	: m_viewBase(viewBase), m_viewSize(viewSize), m_dataOffset(dataOffset) {
+	assert(dataOffset <= viewSize);
+}
+
+// -------------------------------------------------------------------------- //
+
+MappedWindow::~MappedWindow() {
+#ifdef _WIN32
+	::UnmapViewOfFile(m_viewBase);
+#else
+	::munmap(m_viewBase, m_viewSize);
+#endif
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	FileMapping methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+FileMapping::FileMapping (const path& filePath) {
+#ifdef _WIN32
+	m_fileHandle = openForReading(filePath, FILE_FLAG_SEQUENTIAL_SCAN);
+	m_fileSize = fileSizeOf(m_fileHandle);
+
+	if (m_fileSize) {
+		// an empty file can't be mapped, but there's nothing to map in it anyway
+
+		m_mappingHandle = ::CreateFileMappingW(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		if (!m_mappingHandle) {
+			::CloseHandle(m_fileHandle);
+
+			throwLastError("Failed to map the input file");
+		}
+	}
+#else
+	m_fd = openForReading(filePath, false);
+	m_fileSize = fileSizeOf(m_fd);
+#endif
+}
+
+// -------------------------------------------------------------------------- //
+
+FileMapping::~FileMapping() {
+#ifdef _WIN32
+	if (m_mappingHandle) {
+		::CloseHandle(m_mappingHandle);
+	}
+
+	::CloseHandle(m_fileHandle);
+#else
+	::close(m_fd);
+#endif
+}
+
+// -------------------------------------------------------------------------- //
+
+MappedWindowPtr FileMapping::mapWindow (uint64_t offset, size_t length) const {
+	assert(length && offset + length <= m_fileSize);
+
+	// the view has to start at the allocation granularity boundary,
+	// so the window is extended backwards and the data pointer is adjusted accordingly
+
+	auto dataOffset = static_cast<size_t>(offset % allocationGranularity());
+	auto viewOffset = offset - dataOffset;
+	auto viewSize = length + dataOffset;
+
+#ifdef _WIN32
+	void* view = ::MapViewOfFile(m_mappingHandle, FILE_MAP_READ,
+								 static_cast<DWORD>(viewOffset >> 32), static_cast<DWORD>(viewOffset & 0xFFFFFFFF),
+								 viewSize);
+
+	if (!view) {
+		throwLastError("Failed to map a view of the input file");
+	}
+
+	// the window is going to be read through exactly once, so we ask the OS to start
+	// fetching it right away rather than page-faulting it in on a per-page basis
+
+	WIN32_MEMORY_RANGE_ENTRY range{ view, viewSize };
+
+	::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+#else
+	void* view = ::mmap(nullptr, viewSize, PROT_READ, MAP_SHARED, m_fd, static_cast<off_t>(viewOffset));
+
+	if (view == MAP_FAILED) {
+		throwLastError("Failed to map a view of the input file");
+	}
+
+	// the window is going to be read through exactly once, so we ask the OS to start
+	// fetching it right away rather than page-faulting it in on a per-page basis
+
+	::madvise(view, viewSize, MADV_SEQUENTIAL);
+	::madvise(view, viewSize, MADV_WILLNEED);
+#endif
+
+	return MappedWindowPtr(new MappedWindow(view, viewSize, dataOffset));
+}
+
+// -------------------------------------------------------------------------- //
+
+size_t FileMapping::allocationGranularity() {
+#ifdef _WIN32
+	static const size_t granularity = []() {
+		SYSTEM_INFO si;
+
+		::GetSystemInfo(&si);
+
+		return static_cast<size_t>(si.dwAllocationGranularity);
+	}();
+#else
+	static const size_t granularity = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+#endif
+
+	return granularity;
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	MappedOutputFile methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+MappedOutputFile::MappedOutputFile (const path& filePath) {
+#ifdef _WIN32
+	m_fileHandle = ::CreateFileW(filePath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+
+	if (m_fileHandle == INVALID_HANDLE_VALUE) {
+		throwLastError("Failed to open the output file");
+	}
+
+	m_fileSize = fileSizeOf(m_fileHandle);
+#else
+	m_fd = ::open(filePath.c_str(), O_RDWR);
+
+	if (m_fd < 0) {
+		throwLastError("Failed to open the output file");
+	}
+
+	m_fileSize = fileSizeOf(m_fd);
+#endif
+
+	try {
+		assert(m_fileSize);
+
+		if (m_fileSize > std::numeric_limits<size_t>::max()) {
+			throw std::runtime_error("Output file is too large to be mapped");
+		}
+
+#ifdef _WIN32
+		m_mappingHandle = ::CreateFileMappingW(m_fileHandle, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+
+		if (!m_mappingHandle) {
+			throwLastError("Failed to map the output file");
+		}
+
+		m_view = ::MapViewOfFile(m_mappingHandle, FILE_MAP_WRITE, 0, 0, 0);
+
+		if (!m_view) {
+			auto error = ::GetLastError();
+
+			::CloseHandle(m_mappingHandle);
+
+			throw std::system_error(static_cast<int>(error), std::system_category(), "Failed to map a view of the output file");
+		}
+#else
+		m_view = ::mmap(nullptr, static_cast<size_t>(m_fileSize), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+
+		if (m_view == MAP_FAILED) {
+			throwLastError("Failed to map the output file");
+		}
+#endif
+	} catch (...) {
+#ifdef _WIN32
+		::CloseHandle(m_fileHandle);
+#else
+		::close(m_fd);
+#endif
+
+		throw;
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+MappedOutputFile::~MappedOutputFile() {
+#ifdef _WIN32
+	::UnmapViewOfFile(m_view);
+	::CloseHandle(m_mappingHandle);
+	::CloseHandle(m_fileHandle);
+#else
+	::munmap(m_view, static_cast<size_t>(m_fileSize));
+	::close(m_fd);
+#endif
+}
+
+// -------------------------------------------------------------------------- //
+
+void MappedOutputFile::flush() {
+#ifdef _WIN32
+	// flushing the view only hands the dirty pages over to the OS cache,
+	// the file buffers have to be flushed as well to get them on the disk
+
+	if (!::FlushViewOfFile(m_view, 0) || !::FlushFileBuffers(m_fileHandle)) {
+		throwLastError("Failed to flush the output file");
+	}
+#else
+	if (::msync(m_view, static_cast<size_t>(m_fileSize), MS_SYNC) < 0) {
+		throwLastError("Failed to flush the output file");
+	}
+#endif
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	UnbufferedFile methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+UnbufferedFile::UnbufferedFile (const path& filePath) {
+#ifdef _WIN32
+	m_fileHandle = openForReading(filePath, FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN);
+	m_fileSize = fileSizeOf(m_fileHandle);
+#else
+	m_fd = openForReading(filePath, true);
+	m_fileSize = fileSizeOf(m_fd);
+#endif
+}
+
+// -------------------------------------------------------------------------- //
+
+UnbufferedFile::~UnbufferedFile() {
+#ifdef _WIN32
+	::CloseHandle(m_fileHandle);
+#else
+	::close(m_fd);
+#endif
+}
+
+// -------------------------------------------------------------------------- //
+
+size_t UnbufferedFile::readAt (unsigned char* buffer, uint64_t offset, size_t length) {
+	assert(reinterpret_cast<uintptr_t>(buffer) % alignment() == 0 &&
+		   offset % alignment() == 0 && length % alignment() == 0);
+
+	size_t done{ 0 };
+
+	while (done < length) {
+#ifdef _WIN32
+		OVERLAPPED overlapped{};
+		DWORD bytesRead{ 0 };
+
+		overlapped.Offset = static_cast<DWORD>((offset + done) & 0xFFFFFFFF);
+		overlapped.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+
+		if (!::ReadFile(m_fileHandle, buffer + done, static_cast<DWORD>(length - done), &bytesRead, &overlapped)) {
+			if (::GetLastError() == ERROR_HANDLE_EOF) {
+				break;
+			}
+
+			throwLastError("Failed to read the input file");
+		}
+
+		auto res = static_cast<size_t>(bytesRead);
+#else
+		auto res = ::pread(m_fd, buffer + done, length - done, static_cast<off_t>(offset + done));
+
+		if (res < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			throwLastError("Failed to read the input file");
+		}
+#endif
+
+		if (!res) {
+			break;
+		}
+
+		done += static_cast<size_t>(res);
+	}
+
+	return done;
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	SparseFileMap methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+SparseFileMap::SparseFileMap (const path& filePath) {
+	// the file that can't be queried is taken as all data
+	auto queried{ true };
+
+#ifdef _WIN32
+	auto handle = openForReading(filePath, 0);
+
+	m_fileSize = fileSizeOf(handle);
+
+	FILE_ALLOCATED_RANGE_BUFFER query{};
+	FILE_ALLOCATED_RANGE_BUFFER ranges[64];
+
+	query.Length.QuadPart = static_cast<LONGLONG>(m_fileSize);
+
+	while (query.Length.QuadPart > 0) {
+		DWORD bytesReturned{ 0 };
+
+		auto done = ::DeviceIoControl(handle, FSCTL_QUERY_ALLOCATED_RANGES, &query, sizeof(query),
+									  ranges, sizeof(ranges), &bytesReturned, nullptr);
+		auto error = done ? ERROR_SUCCESS : ::GetLastError();
+
+		if (!done && error != ERROR_MORE_DATA) {
+			// the file systems with no sparse files support don't know the request
+			if (error == ERROR_INVALID_FUNCTION || error == ERROR_NOT_SUPPORTED) {
+				queried = false;
+
+				break;
+			}
+
+			::CloseHandle(handle);
+
+			throw std::system_error(static_cast<int>(error), std::system_category(), "Failed to query the allocated ranges of the file");
+		}
+
+		auto count = bytesReturned / sizeof(ranges[0]);
+
+		// the allocation may go on past the end of file
+
+		for (size_t i = 0; i < count; ++i) {
+			auto offset = static_cast<uint64_t>(ranges[i].FileOffset.QuadPart);
+
+			if (offset < m_fileSize) {
+				m_dataRanges.emplace_back(offset, std::min(static_cast<uint64_t>(ranges[i].Length.QuadPart), m_fileSize - offset));
+			}
+		}
+
+		if (done || !count) {
+			break;
+		}
+
+		// carrying on past the last range returned
+
+		auto end = ranges[count - 1].FileOffset.QuadPart + ranges[count - 1].Length.QuadPart;
+
+		query.FileOffset.QuadPart = end;
+		query.Length.QuadPart = static_cast<LONGLONG>(m_fileSize) - end;
+	}
+
+	::CloseHandle(handle);
+#else
+	auto fd = openForReading(filePath, false);
+
+	m_fileSize = fileSizeOf(fd);
+
+#ifdef SEEK_DATA
+	for (off_t position = 0; position < static_cast<off_t>(m_fileSize); ) {
+		auto data = ::lseek(fd, position, SEEK_DATA);
+
+		if (data < 0) {
+			auto error = errno;
+
+			// there's no data past the position
+			if (error == ENXIO) {
+				break;
+			}
+
+			// the file systems with no holes support
+			if (error == EINVAL || error == EOPNOTSUPP) {
+				queried = false;
+
+				break;
+			}
+
+			::close(fd);
+
+			throw std::system_error(error, std::system_category(), "Failed to query the data ranges of the file");
+		}
+
+		auto hole = ::lseek(fd, data, SEEK_HOLE);
+
+		if (hole < 0) {
+			hole = static_cast<off_t>(m_fileSize);
+		}
+
+		m_dataRanges.emplace_back(static_cast<uint64_t>(data), static_cast<uint64_t>(hole - data));
+
+		position = hole;
+	}
+#else
+	queried = false;
+#endif
+
+	::close(fd);
+#endif
+
+	if (!queried) {
+		m_dataRanges.assign(1, { 0, m_fileSize });
+	}
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	AsyncFileReader::Impl struct
+
+	keeps the platform-specific state of the reader, each outstanding request occupies
+	a slot whose index is used to identify its completion
+ */
+// -------------------------------------------------------------------------- //
+
+struct AsyncFileReader::Impl {
+
+	static constexpr unsigned int s_notRegistered{ ~0u };
+	static constexpr unsigned int s_noSlot{ ~0u };
+
+	struct PendingRead {
+#ifdef _WIN32
+		OVERLAPPED overlapped;
+#else
+		iovec iov;
+#endif
+		unsigned char* buffer{ nullptr };
+		uint64_t offset{ 0 };
+		size_t length{ 0 };
+		size_t required{ 0 };
+		size_t done{ 0 };
+		uint64_t tag{ 0 };
+		unsigned int bufferIndex{ s_notRegistered };
+	};
+
+	Impl (const path& filePath, unsigned int depth, bool unbuffered);
+	~Impl();
+
+	// (re)issues the yet unread part of the request occupying the slot
+	void issue (unsigned int slot);
+	void reissue (unsigned int slot);
+	void release (unsigned int slot);
+
+	// waits for any single I/O to complete and returns its slot if the request is done
+	// (or has failed while draining), or s_noSlot if the request has been reissued
+	// to read the rest of the data
+	unsigned int reap (bool draining);
+
+	uint64_t fileSize{ 0 };
+	unsigned int queueDepth;
+	unsigned int outstanding{ 0 };
+
+	std::vector<PendingRead> requests;
+	std::vector<unsigned int> freeSlots;
+
+	// sorted by the address to look the buffer index up when the request is submitted
+	std::vector<std::pair<unsigned char*, size_t>> registered;
+
+#ifdef _WIN32
+	HANDLE file{ INVALID_HANDLE_VALUE };
+	HANDLE port{ nullptr };
+#else
+	int fd{ -1 };
+
+	// the slots completed synchronously when io_uring is not available
+	std::deque<unsigned int> completed;
+
+#ifdef HAS_IO_URING
+	bool setupRing();
+	void teardownRing();
+	void enter (unsigned int minComplete);
+
+	int ringFd{ -1 };
+	unsigned int toSubmit{ 0 };
+
+	void* sqRing{ MAP_FAILED };
+	void* cqRing{ MAP_FAILED };
+	size_t sqRingSize{ 0 };
+	size_t cqRingSize{ 0 };
+	io_uring_sqe* sqes{ static_cast<io_uring_sqe*>(MAP_FAILED) };
+	size_t sqesSize{ 0 };
+
+	unsigned* sqTail{ nullptr };
+	unsigned* sqMask{ nullptr };
+	unsigned* sqArray{ nullptr };
+	unsigned* cqHead{ nullptr };
+	unsigned* cqTail{ nullptr };
+	unsigned* cqMask{ nullptr };
+	io_uring_cqe* cqes{ nullptr };
+#endif
+#endif
+};
+
+// -------------------------------------------------------------------------- //
+
+AsyncFileReader::Impl::Impl (const path& filePath, unsigned int depth, bool unbuffered)
+	: queueDepth(depth), requests(depth), freeSlots(depth) {
+	assert(depth);
+
+	// the slots are taken from the back, so the first requests go to the first slots
+	std::iota(freeSlots.rbegin(), freeSlots.rend(), 0u);
+
+#ifdef _WIN32
+	file = openForReading(filePath, FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN | (unbuffered ? FILE_FLAG_NO_BUFFERING : 0));
+	fileSize = fileSizeOf(file);
+	port = ::CreateIoCompletionPort(file, nullptr, 0, 1);
+
+	if (!port) {
+		::CloseHandle(file);
+
+		throwLastError("Failed to create an I/O completion port");
+	}
+#else
+	fd = openForReading(filePath, unbuffered);
+	fileSize = fileSizeOf(fd);
+
+	::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+#ifdef HAS_IO_URING
+	if (!setupRing()) {
+		// the kernel is too old or io_uring is disabled, the reads are going to be synchronous
+
+		teardownRing();
+	}
+#endif
+#endif
+}
+
+// -------------------------------------------------------------------------- //
+
+AsyncFileReader::Impl::~Impl() {
+#ifdef _WIN32
+	::CloseHandle(port);
+	::CloseHandle(file);
+#else
+#ifdef HAS_IO_URING
+	teardownRing();
+#endif
+
+	::close(fd);
+#endif
+}
+
+// -------------------------------------------------------------------------- //
+
+#ifdef HAS_IO_URING
+
+bool AsyncFileReader::Impl::setupRing() {
+	io_uring_params params;
+
+	std::memset(&params, 0, sizeof(params));
+
+	ringFd = static_cast<int>(::syscall(__NR_io_uring_setup, queueDepth, &params));
+
+	if (ringFd < 0) {
+		return false;
+	}
+
+	sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+	}
+
+	sqRing = ::mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+
+	if (sqRing == MAP_FAILED) {
+		return false;
+	}
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		cqRing = sqRing;
+	} else {
+		cqRing = ::mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+
+		if (cqRing == MAP_FAILED) {
+			return false;
+		}
+	}
+
+	sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+											 ringFd, IORING_OFF_SQES));
+
+	if (sqes == MAP_FAILED) {
+		return false;
+	}
+
+	auto sq = static_cast<unsigned char*>(sqRing);
+	auto cq = static_cast<unsigned char*>(cqRing);
+
+	sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+	sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+	sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+	cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+	cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+	cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+	cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+	return true;
+}
+
+// -------------------------------------------------------------------------- //
+
+void AsyncFileReader::Impl::teardownRing() {
+	if (sqes != MAP_FAILED) {
+		::munmap(sqes, sqesSize);
+		sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+	}
+
+	if (cqRing != MAP_FAILED && cqRing != sqRing) {
+		::munmap(cqRing, cqRingSize);
+	}
+
+	cqRing = MAP_FAILED;
+
+	if (sqRing != MAP_FAILED) {
+		::munmap(sqRing, sqRingSize);
+		sqRing = MAP_FAILED;
+	}
+
+	if (ringFd >= 0) {
+		::close(ringFd);
+		ringFd = -1;
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+void AsyncFileReader::Impl::enter (unsigned int minComplete) {
+	while (true) {
+		auto res = ::syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete,
+							 minComplete ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+
+		if (res >= 0) {
+			toSubmit -= static_cast<unsigned int>(res);
+
+			return;
+		}
+
+		if (errno != EINTR) {
+			throwLastError("Failed to submit a read request");
+		}
+	}
+}
+
+#endif
+
+// -------------------------------------------------------------------------- //
+
+void AsyncFileReader::Impl::issue (unsigned int slot) {
+	auto& r = requests[slot];
+
+	auto target = r.buffer + r.done;
+	auto offset = r.offset + r.done;
+	auto length = r.length - r.done;
+
+#ifdef _WIN32
+	std::memset(&r.overlapped, 0, sizeof(r.overlapped));
+
+	r.overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+	r.overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+	if (!::ReadFile(file, target, static_cast<DWORD>(length), nullptr, &r.overlapped) &&
+		::GetLastError() != ERROR_IO_PENDING) {
+
+		if (::GetLastError() == ERROR_HANDLE_EOF) {
+			throwUnexpectedEof();
+		}
+
+		throwLastError("Failed to read the input file");
+	}
+#else
+#ifdef HAS_IO_URING
+	if (ringFd >= 0) {
+		// the submission queue has at least as many entries as there may be outstanding requests,
+		// so there's always a free entry, and it's only the kernel that reads it
+
+		unsigned tail = *sqTail;
+		unsigned index = tail & *sqMask;
+		io_uring_sqe* sqe = &sqes[index];
+
+		std::memset(sqe, 0, sizeof(*sqe));
+
+		sqe->fd = fd;
+		sqe->off = offset;
+		sqe->user_data = slot;
+
+		if (r.bufferIndex != s_notRegistered) {
+			sqe->opcode = IORING_OP_READ_FIXED;
+			sqe->addr = reinterpret_cast<uint64_t>(target);
+			sqe->len = static_cast<uint32_t>(length);
+			sqe->buf_index = static_cast<uint16_t>(r.bufferIndex);
+		} else {
+			r.iov.iov_base = target;
+			r.iov.iov_len = length;
+
+			sqe->opcode = IORING_OP_READV;
+			sqe->addr = reinterpret_cast<uint64_t>(&r.iov);
+			sqe->len = 1;
+		}
+
+		sqArray[index] = index;
+		__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+		++toSubmit;
+
+		return;
+	}
+#endif
+
+	while (r.done < r.required) {
+		auto res = ::pread(fd, r.buffer + r.done, r.length - r.done, static_cast<off_t>(r.offset + r.done));
+
+		if (res < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			throwLastError("Failed to read the input file");
+		}
+
+		if (res == 0) {
+			throwUnexpectedEof();
+		}
+
+		r.done += static_cast<size_t>(res);
+	}
+
+	completed.push_back(slot);
+#endif
+}
+
+// -------------------------------------------------------------------------- //
+
+void AsyncFileReader::Impl::reissue (unsigned int slot) {
+	try {
+		issue(slot);
+	} catch (...) {
+		// there's no I/O in flight for the slot anymore, so it mustn't be waited for
+		release(slot);
+
+		throw;
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+void AsyncFileReader::Impl::release (unsigned int slot) {
+	freeSlots.push_back(slot);
+	--outstanding;
+}
+
+// -------------------------------------------------------------------------- //
+
+unsigned int AsyncFileReader::Impl::reap (bool draining) {
+#ifdef _WIN32
+	DWORD bytes{ 0 };
+	ULONG_PTR key{ 0 };
+	OVERLAPPED* overlapped{ nullptr };
+
+	auto ok = ::GetQueuedCompletionStatus(port, &bytes, &key, &overlapped, INFINITE);
+
+	if (!overlapped) {
+		throwLastError("Failed to wait for a read request");
+	}
+
+	// the OVERLAPPED struct goes first in the request, so the slot may be restored from its address
+
+	auto slot = static_cast<unsigned int>(reinterpret_cast<PendingRead*>(overlapped) - requests.data());
+	auto& r = requests[slot];
+
+	if (!ok || !bytes) {
+		if (draining) {
+			return slot;
+		}
+
+		auto error = ::GetLastError();
+
+		release(slot);
+
+		if (!ok && error != ERROR_HANDLE_EOF) {
+			throw std::system_error(static_cast<int>(error), std::system_category(), "Failed to read the input file");
+		}
+
+		throwUnexpectedEof();
+	}
+
+	r.done += bytes;
+
+	if (r.done < r.required && !draining) {
+		reissue(slot);
+
+		return s_noSlot;
+	}
+
+	return slot;
+#else
+#ifdef HAS_IO_URING
+	if (ringFd >= 0) {
+		io_uring_cqe cqe;
+
+		while (true) {
+			unsigned head = *cqHead;
+
+			if (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+				cqe = cqes[head & *cqMask];
+				__atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+
+				break;
+			}
+
+			enter(1);
+		}
+
+		auto slot = static_cast<unsigned int>(cqe.user_data);
+		auto& r = requests[slot];
+
+		if (cqe.res <= 0) {
+			if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+				reissue(slot);
+
+				return s_noSlot;
+			}
+
+			if (draining) {
+				return slot;
+			}
+
+			release(slot);
+
+			if (!cqe.res) {
+				throwUnexpectedEof();
+			}
+
+			throw std::system_error(-cqe.res, std::system_category(), "Failed to read the input file");
+		}
+
+		r.done += static_cast<size_t>(cqe.res);
+
+		if (r.done < r.required && !draining) {
+			// a short read, which is legit though unlikely for regular files
+
+			reissue(slot);
+
+			return s_noSlot;
+		}
+
+		return slot;
+	}
+#endif
+
+	assert(!completed.empty());
+
+	auto slot = completed.front();
+	completed.pop_front();
+
+	return slot;
+#endif
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	AsyncFileReader methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+AsyncFileReader::AsyncFileReader (const path& filePath, unsigned int queueDepth, bool unbuffered)
+	: m_impl(new Impl(filePath, queueDepth, unbuffered)) {}
+
+// -------------------------------------------------------------------------- //
+
+AsyncFileReader::~AsyncFileReader() {
+	drain();
+}
+
+// -------------------------------------------------------------------------- //
+
+uint64_t AsyncFileReader::size() const { return m_impl->fileSize; }
+unsigned int AsyncFileReader::queueDepth() const { return m_impl->queueDepth; }
+unsigned int AsyncFileReader::outstanding() const { return m_impl->outstanding; }
+
+// -------------------------------------------------------------------------- //
+
+void AsyncFileReader::registerBuffers (const std::vector<std::pair<unsigned char*, size_t>>& buffers) {
+	assert(m_impl->registered.empty() && !m_impl->outstanding);
+
+#ifdef HAS_IO_URING
+	if (m_impl->ringFd < 0 || buffers.empty()) {
+		return;
+	}
+
+	auto sorted = buffers;
+
+	std::sort(sorted.begin(), sorted.end());
+
+	std::vector<iovec> iovs;
+
+	iovs.reserve(sorted.size());
+
+	for (auto& b : sorted) {
+		iovs.push_back(iovec{ b.first, b.second });
+	}
+
+	// the registration may fail because of the locked memory limits,
+	// in which case the reads just go the regular way
+
+	if (::syscall(__NR_io_uring_register, m_impl->ringFd, IORING_REGISTER_BUFFERS,
+				  iovs.data(), static_cast<unsigned>(iovs.size())) == 0) {
+		m_impl->registered = std::move(sorted);
+	}
+#else
+	(void)buffers;
+#endif
+}
+
+// -------------------------------------------------------------------------- //
+
+void AsyncFileReader::submitRead (unsigned char* buffer, uint64_t offset, size_t length, uint64_t tag) {
+	assert(length && !m_impl->freeSlots.empty());
+
+	auto slot = m_impl->freeSlots.back();
+	auto& r = m_impl->requests[slot];
+
+	r.buffer = buffer;
+	r.offset = offset;
+	r.length = length;
+	r.done = 0;
+
+	// an unbuffered read may be rounded up past the end of file, in which case
+	// it's complete as soon as the rest of the file has been read
+
+	r.required = static_cast<size_t>(std::min<uint64_t>(length, offset < m_impl->fileSize ? m_impl->fileSize - offset : 0));
+	r.tag = tag;
+	r.bufferIndex = Impl::s_notRegistered;
+
+	auto& registered = m_impl->registered;
+	auto it = std::upper_bound(registered.begin(), registered.end(), std::make_pair(buffer, ~size_t{ 0 }));
+
+	if (it != registered.begin()) {
+		--it;
+
+		if (buffer + length <= it->first + it->second) {
+			r.bufferIndex = static_cast<unsigned int>(it - registered.begin());
+		}
+	}
+
+	m_impl->issue(slot);
+
+	m_impl->freeSlots.pop_back();
+	++m_impl->outstanding;
+}
+
+// -------------------------------------------------------------------------- //
+
+uint64_t AsyncFileReader::waitForCompletion() {
+	assert(m_impl->outstanding);
+
+	auto slot = Impl::s_noSlot;
+
+	while (slot == Impl::s_noSlot) {
+		slot = m_impl->reap(false);
+	}
+
+	m_impl->release(slot);
+
+	return m_impl->requests[slot].tag;
+}
+
+// -------------------------------------------------------------------------- //
+
+void AsyncFileReader::drain() noexcept {
+	try {
+		while (m_impl->outstanding) {
+			auto slot = m_impl->reap(true);
+
+			if (slot != Impl::s_noSlot) {
+				m_impl->release(slot);
+			}
+		}
+	} catch (...) {
+		// nothing else can be done about it
+	}
+}
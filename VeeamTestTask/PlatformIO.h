@@ -0,0 +1,248 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <filesystem>
+
+#ifdef _MSC_VER
+using namespace std::experimental::filesystem::v1;
+#else
+using namespace std::filesystem;
+#endif
+
+// -------------------------------------------------------------------------- //
+/*
+	MappedWindow class
+
+	a read-only view of a contiguous region of a memory-mapped file,
+	the region is unmapped when the object is destroyed
+ */
+// -------------------------------------------------------------------------- //
+
+class MappedWindow {
+public:
+
+	MappedWindow (void* viewBase, size_t viewSize, size_t dataOffset);
+	~MappedWindow();
+
+	MappedWindow (const MappedWindow&) = delete;
+	MappedWindow& operator= (const MappedWindow&) = delete;
+
+	const unsigned char* data() const { return static_cast<const unsigned char*>(m_viewBase) + m_dataOffset; }
+	size_t size() const { return m_viewSize - m_dataOffset; }
+
+private:
+
+	void* m_viewBase;
+	size_t m_viewSize;
+	size_t m_dataOffset;
+};
+
+using MappedWindowPtr = std::unique_ptr<MappedWindow>;
+
+// -------------------------------------------------------------------------- //
+/*
+	FileMapping class
+
+	opens the file for reading and maps its arbitrary regions into memory on demand,
+	so that huge files may be processed through a bounded amount of address space
+
+	may throw:
+	- std::system_error - in case the file can't be opened or mapped
+ */
+// -------------------------------------------------------------------------- //
+
+class FileMapping {
+public:
+
+	explicit FileMapping (const path& filePath);
+	~FileMapping();
+
+	FileMapping (const FileMapping&) = delete;
+	FileMapping& operator= (const FileMapping&) = delete;
+
+	uint64_t size() const { return m_fileSize; }
+
+	// the offset doesn't have to be aligned, the alignment is handled internally
+	MappedWindowPtr mapWindow (uint64_t offset, size_t length) const;
+
+	static size_t allocationGranularity();
+
+private:
+
+#ifdef _WIN32
+	void* m_fileHandle{ nullptr };
+	void* m_mappingHandle{ nullptr };
+#else
+	int m_fd{ -1 };
+#endif
+
+	uint64_t m_fileSize{ 0 };
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	MappedOutputFile class
+
+	opens an existing file for writing and maps the whole of it into memory,
+	so that its contents may be filled in place, the changes are guaranteed
+	to reach the disk once flush() returns
+
+	may throw:
+	- std::system_error - in case the file can't be opened, mapped or flushed
+	- std::runtime_error - in case the file doesn't fit in the address space
+ */
+// -------------------------------------------------------------------------- //
+
+class MappedOutputFile {
+public:
+
+	explicit MappedOutputFile (const path& filePath);
+	~MappedOutputFile();
+
+	MappedOutputFile (const MappedOutputFile&) = delete;
+	MappedOutputFile& operator= (const MappedOutputFile&) = delete;
+
+	unsigned char* data() { return static_cast<unsigned char*>(m_view); }
+	uint64_t size() const { return m_fileSize; }
+
+	void flush();
+
+private:
+
+#ifdef _WIN32
+	void* m_fileHandle{ nullptr };
+	void* m_mappingHandle{ nullptr };
+#else
+	int m_fd{ -1 };
+#endif
+
+	void* m_view{ nullptr };
+	uint64_t m_fileSize{ 0 };
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	UnbufferedFile class
+
+	opens the file for reading bypassing the OS cache (O_DIRECT on Linux, no buffering on Windows),
+	the offsets, the lengths and the addresses of the reads must be multiples of alignment()
+
+	may throw:
+	- std::system_error - in case the file can't be opened or an I/O error happens
+ */
+// -------------------------------------------------------------------------- //
+
+class UnbufferedFile {
+public:
+
+	explicit UnbufferedFile (const path& filePath);
+	~UnbufferedFile();
+
+	UnbufferedFile (const UnbufferedFile&) = delete;
+	UnbufferedFile& operator= (const UnbufferedFile&) = delete;
+
+	uint64_t size() const { return m_fileSize; }
+
+	// reads until the length requested or the end of file is reached, returns the number of bytes read
+	size_t readAt (unsigned char* buffer, uint64_t offset, size_t length);
+
+	// covers the sector sizes of all the common drives, as well as the page size
+	static constexpr size_t alignment() { return 4096; }
+
+private:
+
+#ifdef _WIN32
+	void* m_fileHandle{ nullptr };
+#else
+	int m_fd{ -1 };
+#endif
+
+	uint64_t m_fileSize{ 0 };
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	SparseFileMap class
+
+	tells which ranges of the file hold data, as opposed to the holes of a sparse file,
+	which read as zeros (SEEK_DATA and SEEK_HOLE on Linux, FSCTL_QUERY_ALLOCATED_RANGES
+	on Windows); the whole file is taken as data if the file system can't tell
+
+	may throw:
+	- std::system_error - in case the file can't be opened or queried
+ */
+// -------------------------------------------------------------------------- //
+
+class SparseFileMap {
+public:
+
+	explicit SparseFileMap (const path& filePath);
+
+	uint64_t size() const { return m_fileSize; }
+
+	// the offsets and the lengths of the data ranges, in order
+	const std::vector<std::pair<uint64_t, uint64_t>>& dataRanges() const { return m_dataRanges; }
+
+	bool hasHoles() const { return m_fileSize && (m_dataRanges.size() != 1 || m_dataRanges.front().second != m_fileSize); }
+
+private:
+
+	std::vector<std::pair<uint64_t, uint64_t>> m_dataRanges;
+	uint64_t m_fileSize{ 0 };
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	AsyncFileReader class
+
+	opens the file for reading and keeps up to a given number of positioned reads in flight,
+	handing them back in the order of their completion rather than submission
+
+	backed by io_uring on Linux (falling back to synchronous reads should the kernel not
+	support it) and by the overlapped I/O with a completion port on Windows
+
+	if opened for the unbuffered I/O, the same alignment rules as for UnbufferedFile apply,
+	and a read is allowed to stop short at the end of file
+
+	may throw:
+	- std::system_error - in case the file can't be opened or an I/O error happens
+	- std::runtime_error - in case the file turns out to be shorter than expected
+ */
+// -------------------------------------------------------------------------- //
+
+class AsyncFileReader {
+public:
+
+	AsyncFileReader (const path& filePath, unsigned int queueDepth, bool unbuffered = false);
+	~AsyncFileReader();
+
+	AsyncFileReader (const AsyncFileReader&) = delete;
+	AsyncFileReader& operator= (const AsyncFileReader&) = delete;
+
+	uint64_t size() const;
+	unsigned int queueDepth() const;
+	unsigned int outstanding() const;
+
+	// lets the OS pin the memory the reads are going to target once and for all rather than
+	// on a per-request basis, the buffers must stay valid for the lifetime of the reader
+	void registerBuffers (const std::vector<std::pair<unsigned char*, size_t>>& buffers);
+
+	// queues a read request identified by the tag, no more than queueDepth()
+	// requests may be outstanding at a time
+	void submitRead (unsigned char* buffer, uint64_t offset, size_t length, uint64_t tag);
+
+	// blocks until one of the outstanding requests is fully complete and returns its tag
+	uint64_t waitForCompletion();
+
+	// waits for all the outstanding requests ignoring their results, must be called
+	// before the target buffers are released if the reading has been interrupted
+	void drain() noexcept;
+
+private:
+
+	struct Impl;
+
+	std::unique_ptr<Impl> m_impl;
+};
@@ -0,0 +1,205 @@
+#include "stdafx.h"
+#include "RollingChecksum.h"
+#include "Simd.h"
+
+namespace {
+
+// the weights of the bytes of the widest stride by their distance from its end,
+// the narrower strides take the tail of them
+
+alignas(64) const unsigned char s_weights[64] = {
+	64, 63, 62, 61, 60, 59, 58, 57, 56, 55, 54, 53, 52, 51, 50, 49,
+	48, 47, 46, 45, 44, 43, 42, 41, 40, 39, 38, 37, 36, 35, 34, 33,
+	32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+	16, 15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	the strides of the data summed up at a time: the lanes hold the sums of the bytes,
+	the sums of the bytes weighted within their strides, and the sums of the strides
+	before the current one, which are taken once more with every stride that follows;
+	whatever is left after the last whole stride is summed up byte by byte
+ */
+// -------------------------------------------------------------------------- //
+
+struct ScalarLanes {
+	static constexpr size_t s_size{ 1 };
+
+	static void sums (const unsigned char* data, size_t strides, uint32_t& sum, uint32_t& weightedSum) {
+		for (size_t i = 0; i < strides; ++i) {
+			sum += data[i];
+			weightedSum += sum;
+		}
+	}
+};
+
+#ifdef SIMD_X86
+
+struct SSE2Lanes {
+	static constexpr size_t s_size{ 16 };
+
+	static SIMD_TARGET_SSE2 uint32_t sumLanes (__m128i v) {
+		v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+		v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+
+		return static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+	}
+
+	static SIMD_TARGET_SSE2 void sums (const unsigned char* data, size_t strides, uint32_t& sum, uint32_t& weightedSum) {
+		auto zero = _mm_setzero_si128();
+		auto weights = _mm_load_si128(reinterpret_cast<const __m128i*>(s_weights + 64 - s_size));
+		auto weightsLo = _mm_unpacklo_epi8(weights, zero);
+		auto weightsHi = _mm_unpackhi_epi8(weights, zero);
+
+		auto sums = zero, previous = zero, weighted = zero;
+
+		for (size_t i = 0; i < strides; ++i) {
+			auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * s_size));
+
+			previous = _mm_add_epi32(previous, sums);
+			sums = _mm_add_epi32(sums, _mm_sad_epu8(x, zero));
+			weighted = _mm_add_epi32(weighted, _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(x, zero), weightsLo),
+															 _mm_madd_epi16(_mm_unpackhi_epi8(x, zero), weightsHi)));
+		}
+
+		sum = sumLanes(sums);
+		weightedSum = static_cast<uint32_t>(s_size) * sumLanes(previous) + sumLanes(weighted);
+	}
+};
+
+// -------------------------------------------------------------------------- //
+
+struct AVX2Lanes {
+	static constexpr size_t s_size{ 32 };
+
+	static SIMD_TARGET_AVX2 uint32_t sumLanes (__m256i v) {
+		return SSE2Lanes::sumLanes(_mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+	}
+
+	static SIMD_TARGET_AVX2 void sums (const unsigned char* data, size_t strides, uint32_t& sum, uint32_t& weightedSum) {
+		auto zero = _mm256_setzero_si256();
+		auto ones = _mm256_set1_epi16(1);
+		auto weights = _mm256_load_si256(reinterpret_cast<const __m256i*>(s_weights + 64 - s_size));
+
+		auto sums = zero, previous = zero, weighted = zero;
+
+		for (size_t i = 0; i < strides; ++i) {
+			auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i * s_size));
+
+			// the adjacent weighted bytes are added up into 16-bit words, and those into 32-bit ones
+
+			previous = _mm256_add_epi32(previous, sums);
+			sums = _mm256_add_epi32(sums, _mm256_sad_epu8(x, zero));
+			weighted = _mm256_add_epi32(weighted, _mm256_madd_epi16(_mm256_maddubs_epi16(x, weights), ones));
+		}
+
+		sum = sumLanes(sums);
+		weightedSum = static_cast<uint32_t>(s_size) * sumLanes(previous) + sumLanes(weighted);
+	}
+};
+
+// -------------------------------------------------------------------------- //
+
+struct AVX512Lanes {
+	static constexpr size_t s_size{ 64 };
+
+	static SIMD_TARGET_AVX512 uint32_t sumLanes (__m512i v) {
+		return AVX2Lanes::sumLanes(_mm256_add_epi32(_mm512_castsi512_si256(v), _mm512_extracti64x4_epi64(v, 1)));
+	}
+
+	static SIMD_TARGET_AVX512 void sums (const unsigned char* data, size_t strides, uint32_t& sum, uint32_t& weightedSum) {
+		auto zero = _mm512_setzero_si512();
+		auto ones = _mm512_set1_epi16(1);
+		auto weights = _mm512_load_si512(s_weights);
+
+		auto sums = zero, previous = zero, weighted = zero;
+
+		for (size_t i = 0; i < strides; ++i) {
+			auto x = _mm512_loadu_si512(data + i * s_size);
+
+			previous = _mm512_add_epi32(previous, sums);
+			sums = _mm512_add_epi32(sums, _mm512_sad_epu8(x, zero));
+			weighted = _mm512_add_epi32(weighted, _mm512_madd_epi16(_mm512_maddubs_epi16(x, weights), ones));
+		}
+
+		sum = sumLanes(sums);
+		weightedSum = static_cast<uint32_t>(s_size) * sumLanes(previous) + sumLanes(weighted);
+	}
+};
+
+#endif
+
+template <class Lanes>
+void sums (const unsigned char* data, size_t size, uint32_t& sum, uint32_t& weightedSum) {
+	auto strides = size / Lanes::s_size;
+
+	Lanes::sums(data, strides, sum, weightedSum);
+
+	for (auto offset = strides * Lanes::s_size; offset < size; ++offset) {
+		sum += data[offset];
+		weightedSum += sum;
+	}
+}
+
+using sums_fn_t = void (*)(const unsigned char* data, size_t size, uint32_t& sum, uint32_t& weightedSum);
+
+void sumsScalar (const unsigned char* data, size_t size, uint32_t& sum, uint32_t& weightedSum) {
+	sums<ScalarLanes>(data, size, sum, weightedSum);
+}
+
+#ifdef SIMD_X86
+
+SIMD_TARGET_SSE2 SIMD_ENTRY
+void sumsSSE2 (const unsigned char* data, size_t size, uint32_t& sum, uint32_t& weightedSum) {
+	sums<SSE2Lanes>(data, size, sum, weightedSum);
+}
+
+SIMD_TARGET_AVX2 SIMD_ENTRY
+void sumsAVX2 (const unsigned char* data, size_t size, uint32_t& sum, uint32_t& weightedSum) {
+	sums<AVX2Lanes>(data, size, sum, weightedSum);
+}
+
+SIMD_TARGET_AVX512 SIMD_ENTRY
+void sumsAVX512 (const unsigned char* data, size_t size, uint32_t& sum, uint32_t& weightedSum) {
+	sums<AVX512Lanes>(data, size, sum, weightedSum);
+}
+
+#endif
+
+const SimdKernel<sums_fn_t> s_checksumKernels[] = {
+#ifdef SIMD_X86
+	{ SimdLevel::AVX512, &sumsAVX512, "AVX-512" },
+	{ SimdLevel::AVX2, &sumsAVX2, "AVX2" },
+	{ SimdLevel::SSE2, &sumsSSE2, "SSE2" },
+#endif
+	{ SimdLevel::None, &sumsScalar, "C++" }
+};
+
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	RollingChecksum methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+uint32_t RollingChecksum::compute (const unsigned char* data, size_t size) {
+	uint32_t sum{ 0 }, weightedSum{ 0 };
+
+	selectKernel(s_checksumKernels).fn(data, size, sum, weightedSum);
+
+	return combine(sum, weightedSum);
+}
+
+// -------------------------------------------------------------------------- //
+
+RollingChecksum::RollingChecksum (const unsigned char* window, size_t size) : m_size{ static_cast<uint32_t>(size) } {
+	selectKernel(s_checksumKernels).fn(window, size, m_sum, m_weightedSum);
+}
+
+// -------------------------------------------------------------------------- //
+
+const char* RollingChecksum::kernelName() {
+	return selectKernel(s_checksumKernels).name;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// -------------------------------------------------------------------------- //
+/*
+	RollingChecksum class
+
+	the weak checksum of a window of data in the spirit of Adler-32, the one rsync uses:
+	the sum of the bytes and the sum of the bytes weighted by their distance from the end
+	of the window, both modulo 2^16, make the lower and the upper half of it
+
+	the window is rolled one byte forward in constant time, which lets the blocks
+	of a signature be looked for at any offset of another file; the checksum of the whole
+	window is summed up in the vector lanes, several bytes at a time
+ */
+// -------------------------------------------------------------------------- //
+
+class RollingChecksum {
+public:
+
+	static constexpr unsigned int s_size{ 4 };
+
+	// the same as the one of a window over the data
+	static uint32_t compute (const unsigned char* data, size_t size);
+
+	RollingChecksum (const unsigned char* window, size_t size);
+
+	uint32_t value() const { return combine(m_sum, m_weightedSum); }
+
+	// the first byte of the window leaves it, and the one right after it enters
+	void roll (unsigned char out, unsigned char in) {
+		m_sum += in;
+		m_sum -= out;
+		m_weightedSum += m_sum - m_size * out;
+	}
+
+	// the sums are kept modulo 2^32, which doesn't change their lower halves
+	static uint32_t combine (uint32_t sum, uint32_t weightedSum) { return (weightedSum << 16) | (sum & 0xFFFF); }
+
+	static const char* kernelName();
+
+private:
+
+	uint32_t m_sum{ 0 };
+	uint32_t m_weightedSum{ 0 };
+	uint32_t m_size{ 0 };
+};
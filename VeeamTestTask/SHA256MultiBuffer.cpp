@@ -0,0 +1,305 @@
+#include "stdafx.h"
+#include "SHA256MultiBuffer.h"
+#include "CpuFeatures.h"
+#include "Simd.h"
+
+#ifdef SIMD_X86
+
+#ifdef __GNUC__
+// the generic code passes the vectors around by value, but it never ends up
+// out of line, so the calling convention it would have is of no concern
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace {
+
+constexpr size_t s_chunkSize{ 64 };
+
+constexpr uint32_t s_initialState[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+constexpr uint32_t s_roundConstants[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	AVX2Lanes and AVX512Lanes classes
+
+	the vector operations the SHA-256 rounds are made of, for eight and sixteen lanes
+ */
+// -------------------------------------------------------------------------- //
+
+struct AVX2Lanes {
+	using vec_t = __m256i;
+
+	static constexpr unsigned int s_count{ 8 };
+
+	static SIMD_TARGET_AVX2 vec_t set1 (uint32_t x) { return _mm256_set1_epi32(static_cast<int>(x)); }
+	static SIMD_TARGET_AVX2 vec_t add (vec_t a, vec_t b) { return _mm256_add_epi32(a, b); }
+	static SIMD_TARGET_AVX2 vec_t xor3 (vec_t a, vec_t b, vec_t c) { return _mm256_xor_si256(a, _mm256_xor_si256(b, c)); }
+
+	template <int n>
+	static SIMD_TARGET_AVX2 vec_t shr (vec_t x) { return _mm256_srli_epi32(x, n); }
+
+	template <int n>
+	static SIMD_TARGET_AVX2 vec_t ror (vec_t x) { return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n)); }
+
+	// (e & f) ^ (~e & g)
+	static SIMD_TARGET_AVX2 vec_t ch (vec_t e, vec_t f, vec_t g) {
+		return _mm256_xor_si256(g, _mm256_and_si256(e, _mm256_xor_si256(f, g)));
+	}
+
+	// (a & b) ^ (a & c) ^ (b & c)
+	static SIMD_TARGET_AVX2 vec_t maj (vec_t a, vec_t b, vec_t c) {
+		return _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+	}
+
+	// the 16 big-endian message words of a 64-byte chunk of every lane, one word of all the lanes per vector
+	static SIMD_TARGET_AVX2 void load (const unsigned char* const lanes[], size_t offset, vec_t w[16]) {
+		const __m256i swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+											  3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+		for (int half = 0; half < 2; ++half) {
+			for (unsigned int j = 0; j < s_count; ++j) {
+				w[half * 8 + j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes[j] + offset + half * 32));
+			}
+
+			transpose8x8(w + half * 8);
+		}
+
+		for (int i = 0; i < 16; ++i) {
+			w[i] = _mm256_shuffle_epi8(w[i], swap);
+		}
+	}
+
+	static SIMD_TARGET_AVX2 void store (uint32_t* words, vec_t x) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(words), x); }
+};
+
+// -------------------------------------------------------------------------- //
+
+struct AVX512Lanes {
+	using vec_t = __m512i;
+
+	static constexpr unsigned int s_count{ 16 };
+
+	static SIMD_TARGET_AVX512 vec_t set1 (uint32_t x) { return _mm512_set1_epi32(static_cast<int>(x)); }
+	static SIMD_TARGET_AVX512 vec_t add (vec_t a, vec_t b) { return _mm512_add_epi32(a, b); }
+	static SIMD_TARGET_AVX512 vec_t xor3 (vec_t a, vec_t b, vec_t c) { return _mm512_ternarylogic_epi32(a, b, c, 0x96); }
+
+	template <int n>
+	static SIMD_TARGET_AVX512 vec_t shr (vec_t x) { return _mm512_srli_epi32(x, n); }
+
+	template <int n>
+	static SIMD_TARGET_AVX512 vec_t ror (vec_t x) { return _mm512_ror_epi32(x, n); }
+
+	static SIMD_TARGET_AVX512 vec_t ch (vec_t e, vec_t f, vec_t g) { return _mm512_ternarylogic_epi32(e, f, g, 0xCA); }
+	static SIMD_TARGET_AVX512 vec_t maj (vec_t a, vec_t b, vec_t c) { return _mm512_ternarylogic_epi32(a, b, c, 0xE8); }
+
+	// the lanes are transposed in two groups of eight, which are then put side by side
+	static SIMD_TARGET_AVX512 void load (const unsigned char* const lanes[], size_t offset, vec_t w[16]) {
+		const __m512i swap = _mm512_broadcast_i32x4(_mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+
+		for (int half = 0; half < 2; ++half) {
+			__m256i lo[8], hi[8];
+
+			for (unsigned int j = 0; j < 8; ++j) {
+				lo[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes[j] + offset + half * 32));
+				hi[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes[j + 8] + offset + half * 32));
+			}
+
+			transpose8x8(lo);
+			transpose8x8(hi);
+
+			for (int i = 0; i < 8; ++i) {
+				w[half * 8 + i] = _mm512_shuffle_epi8(_mm512_inserti64x4(_mm512_castsi256_si512(lo[i]), hi[i], 1), swap);
+			}
+		}
+	}
+
+	static SIMD_TARGET_AVX512 void store (uint32_t* words, vec_t x) { _mm512_storeu_si512(words, x); }
+};
+
+// -------------------------------------------------------------------------- //
+/*
+	Kernel class
+
+	SHA-256 written in terms of the lane operations
+ */
+// -------------------------------------------------------------------------- //
+
+template <class Lanes>
+struct Kernel {
+	using vec_t = typename Lanes::vec_t;
+
+	static vec_t bigSigma0 (vec_t a) { return Lanes::xor3(Lanes::template ror<2>(a), Lanes::template ror<13>(a), Lanes::template ror<22>(a)); }
+	static vec_t bigSigma1 (vec_t e) { return Lanes::xor3(Lanes::template ror<6>(e), Lanes::template ror<11>(e), Lanes::template ror<25>(e)); }
+	static vec_t sigma0 (vec_t w) { return Lanes::xor3(Lanes::template ror<7>(w), Lanes::template ror<18>(w), Lanes::template shr<3>(w)); }
+	static vec_t sigma1 (vec_t w) { return Lanes::xor3(Lanes::template ror<17>(w), Lanes::template ror<19>(w), Lanes::template shr<10>(w)); }
+
+	// the message schedule is kept in a ring of 16 words, the i-th word is put in place of the (i - 16)-th one
+	static vec_t scheduledWord (vec_t w[16], int i) {
+		if (i >= 16) {
+			w[i & 15] = Lanes::add(Lanes::add(w[i & 15], sigma0(w[(i - 15) & 15])),
+								   Lanes::add(w[(i - 7) & 15], sigma1(w[(i - 2) & 15])));
+		}
+
+		return Lanes::add(w[i & 15], Lanes::set1(s_roundConstants[i]));
+	}
+
+	// rather than shifting the working variables, the callers rotate the arguments
+	static void round (vec_t a, vec_t b, vec_t c, vec_t& d, vec_t e, vec_t f, vec_t g, vec_t& h, vec_t kw) {
+		auto t1 = Lanes::add(Lanes::add(h, bigSigma1(e)), Lanes::add(Lanes::ch(e, f, g), kw));
+		auto t2 = Lanes::add(bigSigma0(a), Lanes::maj(a, b, c));
+
+		d = Lanes::add(d, t1);
+		h = Lanes::add(t1, t2);
+	}
+
+	static void transform (vec_t state[8], const unsigned char* const lanes[], size_t offset) {
+		vec_t w[16];
+
+		Lanes::load(lanes, offset, w);
+
+		vec_t a = state[0], b = state[1], c = state[2], d = state[3];
+		vec_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+		for (int i = 0; i < 64; i += 8) {
+			round(a, b, c, d, e, f, g, h, scheduledWord(w, i));
+			round(h, a, b, c, d, e, f, g, scheduledWord(w, i + 1));
+			round(g, h, a, b, c, d, e, f, scheduledWord(w, i + 2));
+			round(f, g, h, a, b, c, d, e, scheduledWord(w, i + 3));
+			round(e, f, g, h, a, b, c, d, scheduledWord(w, i + 4));
+			round(d, e, f, g, h, a, b, c, scheduledWord(w, i + 5));
+			round(c, d, e, f, g, h, a, b, scheduledWord(w, i + 6));
+			round(b, c, d, e, f, g, h, a, scheduledWord(w, i + 7));
+		}
+
+		state[0] = Lanes::add(state[0], a);
+		state[1] = Lanes::add(state[1], b);
+		state[2] = Lanes::add(state[2], c);
+		state[3] = Lanes::add(state[3], d);
+		state[4] = Lanes::add(state[4], e);
+		state[5] = Lanes::add(state[5], f);
+		state[6] = Lanes::add(state[6], g);
+		state[7] = Lanes::add(state[7], h);
+	}
+
+	static void hash (const unsigned char* const lanes[], size_t length, unsigned char* const digests[], unsigned int count) {
+		vec_t state[8];
+
+		for (int i = 0; i < 8; ++i) {
+			state[i] = Lanes::set1(s_initialState[i]);
+		}
+
+		auto fullChunks = length / s_chunkSize;
+
+		for (size_t i = 0; i < fullChunks; ++i) {
+			transform(state, lanes, i * s_chunkSize);
+		}
+
+		// the padding and the big-endian message length in bits take one or two more chunks
+
+		unsigned char tails[Lanes::s_count][2 * s_chunkSize];
+		const unsigned char* tailLanes[Lanes::s_count];
+
+		auto rest = length % s_chunkSize;
+		auto tailSize = rest < s_chunkSize - sizeof(uint64_t) ? s_chunkSize : 2 * s_chunkSize;
+		uint64_t bitLength = static_cast<uint64_t>(length) * 8;
+
+		for (unsigned int j = 0; j < Lanes::s_count; ++j) {
+			std::memcpy(tails[j], lanes[j] + fullChunks * s_chunkSize, rest);
+			tails[j][rest] = 0x80;
+			std::memset(tails[j] + rest + 1, 0, tailSize - rest - 1);
+
+			for (size_t i = 0; i < sizeof(bitLength); ++i) {
+				tails[j][tailSize - 1 - i] = static_cast<unsigned char>(bitLength >> (i * 8));
+			}
+
+			tailLanes[j] = tails[j];
+		}
+
+		for (size_t offset = 0; offset < tailSize; offset += s_chunkSize) {
+			transform(state, tailLanes, offset);
+		}
+
+		uint32_t words[8][Lanes::s_count];
+
+		for (int i = 0; i < 8; ++i) {
+			Lanes::store(words[i], state[i]);
+		}
+
+		for (unsigned int j = 0; j < count; ++j) {
+			for (int i = 0; i < 8; ++i) {
+				for (int k = 0; k < 4; ++k) {
+					digests[j][i * 4 + k] = static_cast<unsigned char>(words[i][j] >> (24 - k * 8));
+				}
+			}
+		}
+	}
+};
+
+SIMD_TARGET_AVX2 SIMD_ENTRY
+void hashAVX2 (const unsigned char* const lanes[], size_t length, unsigned char* const digests[], unsigned int count) {
+	Kernel<AVX2Lanes>::hash(lanes, length, digests, count);
+}
+
+SIMD_TARGET_AVX512 SIMD_ENTRY
+void hashAVX512 (const unsigned char* const lanes[], size_t length, unsigned char* const digests[], unsigned int count) {
+	Kernel<AVX512Lanes>::hash(lanes, length, digests, count);
+}
+
+}
+
+#endif
+
+// -------------------------------------------------------------------------- //
+/*
+	SHA256MultiBuffer methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+unsigned int SHA256MultiBuffer::lanes() {
+#ifdef SIMD_X86
+	if (CpuFeatures::hasAVX512()) {
+		return AVX512Lanes::s_count;
+	}
+
+	if (CpuFeatures::hasAVX2()) {
+		return AVX2Lanes::s_count;
+	}
+#endif
+	return 0;
+}
+
+// -------------------------------------------------------------------------- //
+
+void SHA256MultiBuffer::hash (const unsigned char* const inputs[], size_t length, unsigned char* const digests[], unsigned int count) {
+	auto laneCount = lanes();
+
+	assert(count >= 1 && count <= laneCount);
+
+#ifdef SIMD_X86
+	// the spare lanes just repeat the last input, their digests are thrown away
+
+	const unsigned char* padded[s_maxLanes];
+
+	for (unsigned int j = 0; j < laneCount; ++j) {
+		padded[j] = inputs[j < count ? j : count - 1];
+	}
+
+	if (laneCount == AVX512Lanes::s_count) {
+		hashAVX512(padded, length, digests, count);
+	} else {
+		hashAVX2(padded, length, digests, count);
+	}
+#endif
+}
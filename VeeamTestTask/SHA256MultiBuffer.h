@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+
+// -------------------------------------------------------------------------- //
+/*
+	SHA256MultiBuffer class
+
+	the counterpart of MD5MultiBuffer for SHA-256: several independent messages
+	of the same length are hashed in lockstep, each one in its own 32-bit lane,
+	eight of them with AVX2 and sixteen with AVX-512
+
+	both flavours are meant for the CPUs lacking the SHA extensions, the ones having them
+	hash a block at a time with those
+ */
+// -------------------------------------------------------------------------- //
+
+class SHA256MultiBuffer {
+public:
+
+	static constexpr unsigned int s_maxLanes{ 16 };
+
+	// the number of messages hashed at once on this CPU, zero if there's no suitable kernel
+	static unsigned int lanes();
+
+	// hashes from 1 to lanes() inputs of the given length, the digests are 32 bytes each
+	static void hash (const unsigned char* const inputs[], size_t length, unsigned char* const digests[], unsigned int count);
+};
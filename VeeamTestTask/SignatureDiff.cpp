@@ -0,0 +1,360 @@
+#include "stdafx.h"
+#include "SignatureDiff.h"
+#include "SignatureFile.h"
+#include "Simd.h"
+
+namespace {
+
+// the slices of the digest tables compared by the threads are no smaller than this
+
+constexpr uint64_t s_minSliceSize{ 16 * 1024 * 1024 };
+
+// the blocks under the tree nodes of this level or below are compared in slices rather than node by node
+
+constexpr size_t s_sliceLevel{ 5 };
+
+// -------------------------------------------------------------------------- //
+/*
+	the strides of the digest tables compared at a time, any difference within a stride
+	is then looked for byte by byte
+ */
+// -------------------------------------------------------------------------- //
+
+struct ScalarStride {
+	static constexpr size_t s_size{ 8 };
+
+	static bool equal (const unsigned char* a, const unsigned char* b) {
+		uint64_t x, y;
+
+		std::memcpy(&x, a, sizeof(x));
+		std::memcpy(&y, b, sizeof(y));
+
+		return x == y;
+	}
+};
+
+#ifdef SIMD_X86
+
+struct SSE2Stride {
+	static constexpr size_t s_size{ 64 };
+
+	static SIMD_TARGET_SSE2 bool equal (const unsigned char* a, const unsigned char* b) {
+		auto pa = reinterpret_cast<const __m128i*>(a);
+		auto pb = reinterpret_cast<const __m128i*>(b);
+
+		auto eq01 = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128(pa), _mm_loadu_si128(pb)),
+								  _mm_cmpeq_epi8(_mm_loadu_si128(pa + 1), _mm_loadu_si128(pb + 1)));
+		auto eq23 = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128(pa + 2), _mm_loadu_si128(pb + 2)),
+								  _mm_cmpeq_epi8(_mm_loadu_si128(pa + 3), _mm_loadu_si128(pb + 3)));
+
+		return _mm_movemask_epi8(_mm_and_si128(eq01, eq23)) == 0xFFFF;
+	}
+};
+
+// -------------------------------------------------------------------------- //
+
+struct AVX2Stride {
+	static constexpr size_t s_size{ 128 };
+
+	static SIMD_TARGET_AVX2 bool equal (const unsigned char* a, const unsigned char* b) {
+		auto pa = reinterpret_cast<const __m256i*>(a);
+		auto pb = reinterpret_cast<const __m256i*>(b);
+
+		auto eq01 = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256(pa), _mm256_loadu_si256(pb)),
+									 _mm256_cmpeq_epi8(_mm256_loadu_si256(pa + 1), _mm256_loadu_si256(pb + 1)));
+		auto eq23 = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256(pa + 2), _mm256_loadu_si256(pb + 2)),
+									 _mm256_cmpeq_epi8(_mm256_loadu_si256(pa + 3), _mm256_loadu_si256(pb + 3)));
+
+		return _mm256_movemask_epi8(_mm256_and_si256(eq01, eq23)) == -1;
+	}
+};
+
+// -------------------------------------------------------------------------- //
+
+struct AVX512Stride {
+	static constexpr size_t s_size{ 128 };
+
+	static SIMD_TARGET_AVX512 bool equal (const unsigned char* a, const unsigned char* b) {
+		auto ne0 = _mm512_cmpneq_epu64_mask(_mm512_loadu_si512(a), _mm512_loadu_si512(b));
+		auto ne1 = _mm512_cmpneq_epu64_mask(_mm512_loadu_si512(a + 64), _mm512_loadu_si512(b + 64));
+
+		return !(ne0 | ne1);
+	}
+};
+
+#endif
+
+// the offset of the first byte that differs between the tables, or the size if there is none
+
+template <class Stride>
+size_t mismatch (const unsigned char* a, const unsigned char* b, size_t size) {
+	size_t offset{ 0 };
+
+	while (offset + Stride::s_size <= size && Stride::equal(a + offset, b + offset)) {
+		offset += Stride::s_size;
+	}
+
+	while (offset < size && a[offset] == b[offset]) {
+		++offset;
+	}
+
+	return offset;
+}
+
+using mismatch_fn_t = size_t (*)(const unsigned char* a, const unsigned char* b, size_t size);
+
+size_t mismatchScalar (const unsigned char* a, const unsigned char* b, size_t size) {
+	return mismatch<ScalarStride>(a, b, size);
+}
+
+#ifdef SIMD_X86
+
+SIMD_TARGET_SSE2 SIMD_ENTRY
+size_t mismatchSSE2 (const unsigned char* a, const unsigned char* b, size_t size) {
+	return mismatch<SSE2Stride>(a, b, size);
+}
+
+SIMD_TARGET_AVX2 SIMD_ENTRY
+size_t mismatchAVX2 (const unsigned char* a, const unsigned char* b, size_t size) {
+	return mismatch<AVX2Stride>(a, b, size);
+}
+
+SIMD_TARGET_AVX512 SIMD_ENTRY
+size_t mismatchAVX512 (const unsigned char* a, const unsigned char* b, size_t size) {
+	return mismatch<AVX512Stride>(a, b, size);
+}
+
+#endif
+
+const SimdKernel<mismatch_fn_t> s_compareKernels[] = {
+#ifdef SIMD_X86
+	{ SimdLevel::AVX512, &mismatchAVX512, "AVX-512" },
+	{ SimdLevel::AVX2, &mismatchAVX2, "AVX2" },
+	{ SimdLevel::SSE2, &mismatchSSE2, "SSE2" },
+#endif
+	{ SimdLevel::None, &mismatchScalar, "C++" }
+};
+
+// the ranges of the blocks whose digests differ, out of the given slice of the tables
+
+void compareSlice (const unsigned char* a, const unsigned char* b, unsigned int digestSize,
+				   uint64_t firstBlock, uint64_t endBlock, std::vector<block_range_t>& ranges) {
+	auto mismatch = selectKernel(s_compareKernels).fn;
+
+	auto differs = [a, b, digestSize](uint64_t block) {
+		auto offset = static_cast<size_t>(block * digestSize);
+
+		return std::memcmp(a + offset, b + offset, digestSize) != 0;
+	};
+
+	for (auto block = firstBlock; block < endBlock; ) {
+		auto offset = static_cast<size_t>(block * digestSize);
+
+		block += mismatch(a + offset, b + offset, static_cast<size_t>((endBlock - block) * digestSize)) / digestSize;
+
+		if (block == endBlock) {
+			break;
+		}
+
+		auto first = block;
+
+		while (++block < endBlock && differs(block));
+
+		ranges.emplace_back(first, block - 1);
+	}
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	the ranges of the blocks whose digests differ, found by descending the Merkle trees
+	of both signatures from the top into the subtrees whose roots differ only; a node
+	is only compared to its counterpart if both of them cover the same blocks, which
+	the nodes at the end of the trees of the files of different sizes don't
+ */
+// -------------------------------------------------------------------------- //
+
+class TreeComparison {
+public:
+
+	TreeComparison (const SignatureFile& a, const SignatureFile& b, uint64_t commonBlocks, std::vector<block_range_t>& ranges)
+		: m_a(a), m_b(b), m_commonBlocks(commonBlocks), m_sameSize(a.header().originalFileSize == b.header().originalFileSize),
+		  m_ranges(ranges) {
+		if (!commonBlocks) {
+			return;
+		}
+
+		// the single node of the top level of the smaller tree covers all the blocks in common
+
+		descend(std::min(a.tree().levelCount(), b.tree().levelCount()) - 1, 0);
+	}
+
+private:
+
+	void descend (size_t level, uint64_t index) {
+		auto first = index << level;
+
+		if (first >= m_commonBlocks) {
+			return;
+		}
+
+		auto end = (index + 1) << level;
+		auto comparable = end <= m_commonBlocks || m_sameSize;
+
+		if (comparable && !std::memcmp(m_a.node(level, index), m_b.node(level, index), m_a.digestSize())) {
+			return;
+		}
+
+		if (level <= s_sliceLevel) {
+			compareSlice(m_a.digests(), m_b.digests(), m_a.digestSize(), first, std::min(end, m_commonBlocks), m_ranges);
+
+			return;
+		}
+
+		descend(level - 1, index * 2);
+		descend(level - 1, index * 2 + 1);
+	}
+
+private:
+
+	const SignatureFile& m_a;
+	const SignatureFile& m_b;
+	uint64_t m_commonBlocks;
+	bool m_sameSize;
+	std::vector<block_range_t>& m_ranges;
+};
+
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	SignatureDiff methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+SignatureDiff::SignatureDiff (const char* oldSignaturePath, const char* newSignaturePath) {
+	compare(path{ oldSignaturePath }, path{ newSignaturePath });
+}
+
+// -------------------------------------------------------------------------- //
+
+SignatureDiff::SignatureDiff (const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* oldSignaturePath,
+							  const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* newSignaturePath) {
+	compare(path{ oldSignaturePath }, path{ newSignaturePath });
+}
+
+// -------------------------------------------------------------------------- //
+
+void SignatureDiff::compare (const path& oldSignaturePath, const path& newSignaturePath) {
+	SignatureFile oldSignature{ oldSignaturePath };
+	SignatureFile newSignature{ newSignaturePath };
+
+	if (oldSignature.isChunked() || newSignature.isChunked()) {
+		throw std::runtime_error("The signatures made of content-defined chunks can't be compared block by block");
+	}
+
+	if (oldSignature.hashFunctionId() != newSignature.hashFunctionId()) {
+		throw std::runtime_error("The signatures are made with different hash methods");
+	}
+
+	if (oldSignature.header().blockSize != newSignature.header().blockSize) {
+		throw std::runtime_error("The signatures are made with different block sizes");
+	}
+
+	m_hashFunctionId = oldSignature.hashFunctionId();
+	m_blockSize = oldSignature.header().blockSize;
+
+	auto oldSize = oldSignature.header().originalFileSize;
+	auto newSize = newSignature.header().originalFileSize;
+	auto digestSize = oldSignature.digestSize();
+
+	// the blocks of both files are only worth comparing while they are of the same size,
+	// which the last block of the shorter file isn't, unless it's a whole one
+
+	auto commonBlocks = std::min(oldSignature.blockCount(), newSignature.blockCount());
+	auto totalBlocks = std::max(oldSignature.blockCount(), newSignature.blockCount());
+
+	if (oldSize != newSize && std::min(oldSize, newSize) % m_blockSize) {
+		--commonBlocks;
+	}
+
+	// the trees, if both signatures have them, lead straight to the blocks changed
+
+	if (oldSignature.hasMerkleTree() && newSignature.hasMerkleTree()) {
+		TreeComparison{ oldSignature, newSignature, commonBlocks, m_changes };
+
+		if (commonBlocks < totalBlocks) {
+			m_changes.emplace_back(commonBlocks, totalBlocks - 1);
+		}
+
+		// the ranges found in the adjacent subtrees are joined
+
+		std::vector<block_range_t> changes;
+
+		for (auto& range : m_changes) {
+			if (!changes.empty() && changes.back().second + 1 == range.first) {
+				changes.back().second = range.second;
+			} else {
+				changes.push_back(range);
+			}
+		}
+
+		m_changes = std::move(changes);
+
+		return;
+	}
+
+	auto threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	auto sliceCount = std::max<uint64_t>(std::min<uint64_t>(threadCount, commonBlocks * digestSize / s_minSliceSize), 1);
+	auto sliceBlocks = (commonBlocks + sliceCount - 1) / sliceCount;
+
+	std::vector<std::vector<block_range_t>> sliceRanges(static_cast<size_t>(sliceCount));
+
+	{
+		std::vector<std::thread> workers;
+
+		auto joinWorkers = [&workers]() {
+			for (auto& t : workers) {
+				t.join();
+			}
+		};
+
+		try {
+			for (uint64_t s = 1; s < sliceCount; ++s) {
+				workers.emplace_back(compareSlice, oldSignature.digests(), newSignature.digests(), digestSize,
+									 s * sliceBlocks, std::min(commonBlocks, (s + 1) * sliceBlocks), std::ref(sliceRanges[s]));
+			}
+		} catch (...) {
+			joinWorkers();
+
+			throw;
+		}
+
+		// the first slice is compared by this thread
+
+		compareSlice(oldSignature.digests(), newSignature.digests(), digestSize, 0, std::min(commonBlocks, sliceBlocks), sliceRanges[0]);
+
+		joinWorkers();
+	}
+
+	if (commonBlocks < totalBlocks) {
+		sliceRanges.back().emplace_back(commonBlocks, totalBlocks - 1);
+	}
+
+	// the ranges meeting at the slice boundaries are joined
+
+	for (auto& ranges : sliceRanges) {
+		for (auto& range : ranges) {
+			if (!m_changes.empty() && m_changes.back().second + 1 == range.first) {
+				m_changes.back().second = range.second;
+			} else {
+				m_changes.push_back(range);
+			}
+		}
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+const char* SignatureDiff::kernelName() {
+	return selectKernel(s_compareKernels).name;
+}
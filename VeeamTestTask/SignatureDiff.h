@@ -0,0 +1,50 @@
+#pragma once
+
+#include "FileSignatureCreator.h"
+
+// -------------------------------------------------------------------------- //
+/*
+	SignatureDiff class
+
+	create an object of this class to find the blocks that differ between two signatures
+	of the same hash method and block size, with no access to the files they were made of;
+	the ranges of changed blocks are given by their first and last blocks, in order, and the
+	blocks present in one of the signatures only are changed as well as the last block of
+	the shorter file, unless it's a whole one
+
+	the digest tables of both signatures are mapped into memory and compared in slices by
+	several threads; if both signatures have Merkle trees, they are descended from the top
+	instead, and only the blocks under the subtrees whose roots differ are compared
+
+	may throw:
+	- std::runtime_error - in case the signatures are invalid or can't be compared
+	- std::system_error - in case the files can't be opened or mapped, or of thread-related issues
+	- std::bad_alloc - in case of memory shortage
+ */
+// -------------------------------------------------------------------------- //
+
+class SignatureDiff {
+public:
+
+	SignatureDiff (const char* oldSignaturePath, const char* newSignaturePath);
+	SignatureDiff (const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* oldSignaturePath,
+				   const std::enable_if_t<!std::is_same_v<char, path::value_type>, path::value_type>* newSignaturePath);
+	~SignatureDiff() = default;
+
+	HashFunctionId hashFunctionId() const { return m_hashFunctionId; }
+	uint32_t blockSize() const { return m_blockSize; }
+
+	const std::vector<block_range_t>& changes() const { return m_changes; }
+
+	static const char* kernelName();
+
+private:
+
+	void compare(const path& oldSignaturePath, const path& newSignaturePath);
+
+private:
+
+	HashFunctionId m_hashFunctionId{ HashFunctionId::CRC32 };
+	uint32_t m_blockSize{ 0 };
+	std::vector<block_range_t> m_changes;
+};
@@ -0,0 +1,247 @@
+#include "stdafx.h"
+#include "SignatureFile.h"
+#include "HashWrappers.h"
+
+// -------------------------------------------------------------------------- //
+/*
+	SignatureFile methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+SignatureFile::SignatureFile (const path& filePath) : m_mapping{ filePath } {
+	if (m_mapping.size() < SignatureHeaderTraits::size()) {
+		throw std::runtime_error("The signature file is too short");
+	}
+
+	if (m_mapping.size() > std::numeric_limits<size_t>::max()) {
+		throw std::runtime_error("The signature file doesn't fit in the address space");
+	}
+
+	m_window = m_mapping.mapWindow(0, static_cast<size_t>(m_mapping.size()));
+
+	// the header is read field by field, the way it's been written
+
+	auto pos = m_window->data();
+	auto get = [&pos](auto& field) {
+		std::memcpy(&field, pos, sizeof(field));
+		pos += sizeof(field);
+	};
+
+	get(m_header.fileMark);
+	get(m_header.formatVersion);
+	get(m_header.hashFunctionId);
+	get(m_header.originalFileSize);
+	get(m_header.blockSize);
+	get(m_header.flags);
+	get(m_header.sourceWriteTime);
+
+	if (m_header.fileMark != SignatureHeader{}.fileMark) {
+		throw std::runtime_error("The file is not a signature");
+	}
+
+	if (m_header.formatVersion < 1 || m_header.formatVersion > SignatureHeaderTraits::sectionedVersion()) {
+		throw std::runtime_error("Unsupported signature format version");
+	}
+
+	// there are no flags in the first version, nor the last write time of the input
+	if (m_header.formatVersion == 1) {
+		m_header.flags = 0;
+		m_header.sourceWriteTime = 0;
+	}
+
+	if (!m_header.blockSize) {
+		throw std::runtime_error("The signature block size is zero");
+	}
+
+	if (m_header.hashFunctionId > static_cast<uint16_t>(HashFunctionId::BLAKE3)) {
+		throw std::runtime_error("Unknown signature hash method");
+	}
+
+	m_digestSize = HashTraits::digestSize(hashFunctionId());
+	m_digests = m_window->data() + SignatureHeaderTraits::size();
+
+	if (isChunked()) {
+		readChunks();
+
+		return;
+	}
+
+	m_blockCount = m_header.originalFileSize / m_header.blockSize + (m_header.originalFileSize % m_header.blockSize > 0);
+
+	if (hasMerkleTree()) {
+		m_tree = MerkleTreeLayout{ m_blockCount };
+	}
+
+	if (isSectioned()) {
+		readSections();
+
+		return;
+	}
+
+	if (hasBlockContents()) {
+		throw std::runtime_error("The block contents are only found in the signature sections");
+	}
+
+	m_levels = digests() + static_cast<size_t>(m_blockCount * m_digestSize);
+
+	auto digestCount = hasMerkleTree() ? m_tree.nodeCount() : m_blockCount;
+
+	auto checksumCount = hasWeakChecksums() ? m_blockCount : 0;
+
+	if (m_mapping.size() != SignatureHeaderTraits::size() + digestCount * m_digestSize + checksumCount * RollingChecksum::s_size) {
+		throw std::runtime_error("The signature file size doesn't match its header");
+	}
+
+	if (hasWeakChecksums()) {
+		m_weakChecksums = digests() + static_cast<size_t>(digestCount * m_digestSize);
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+byte_range_t SignatureFile::chunk (uint64_t index) const {
+	uint64_t offset;
+	uint32_t size;
+
+	std::memcpy(&offset, chunkRecord(index), sizeof(offset));
+	std::memcpy(&size, chunkRecord(index) + sizeof(offset), sizeof(size));
+
+	return { offset, size };
+}
+
+// -------------------------------------------------------------------------- //
+
+void SignatureFile::readChunks() {
+	auto recordSize = SignatureHeaderTraits::chunkRecordSize(m_digestSize);
+	auto tableStart = SignatureHeaderTraits::size() + SignatureHeaderTraits::chunkSizesSize();
+
+	if (m_mapping.size() < tableStart || (m_mapping.size() - tableStart) % recordSize) {
+		throw std::runtime_error("The signature file size doesn't match its header");
+	}
+
+	auto tableSize = m_mapping.size() - tableStart;
+
+	// the chunk sizes are read field by field, the way they've been written
+
+	auto pos = m_window->data() + SignatureHeaderTraits::size();
+	auto get = [&pos](auto& field) {
+		std::memcpy(&field, pos, sizeof(field));
+		pos += sizeof(field);
+	};
+
+	get(m_chunkSizes.minSize);
+	get(m_chunkSizes.averageSize);
+	get(m_chunkSizes.maxSize);
+
+	if (!m_chunkSizes.minSize || m_chunkSizes.minSize > m_chunkSizes.averageSize ||
+		m_chunkSizes.averageSize > m_chunkSizes.maxSize || m_chunkSizes.maxSize != m_header.blockSize) {
+		throw std::runtime_error("The signature chunk sizes are inconsistent");
+	}
+
+	m_digests = m_window->data() + tableStart;
+
+	m_blockCount = tableSize / recordSize;
+
+	// the chunks must cover the whole file one after another
+
+	uint64_t offset{ 0 };
+
+	for (uint64_t index = 0; index < m_blockCount; ++index) {
+		auto range = chunk(index);
+
+		if (range.first != offset || !range.second || range.second > m_chunkSizes.maxSize) {
+			throw std::runtime_error("The signature chunk table is inconsistent");
+		}
+
+		offset += range.second;
+	}
+
+	if (offset != m_header.originalFileSize) {
+		throw std::runtime_error("The signature chunk table doesn't match its header");
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+void SignatureFile::readSections() {
+	if (m_mapping.size() < SignatureHeaderTraits::size() + SignatureHeaderTraits::sectionTableHeaderSize()) {
+		throw std::runtime_error("The signature section table doesn't fit in the file");
+	}
+
+	// the table is read field by field, the way it's been written
+
+	auto pos = m_window->data() + SignatureHeaderTraits::size();
+	auto get = [&pos](auto& field) {
+		std::memcpy(&field, pos, sizeof(field));
+		pos += sizeof(field);
+	};
+
+	uint32_t sectionCount, entrySize;
+
+	get(sectionCount);
+	get(entrySize);
+
+	// the entries may grow longer in the later versions, whatever follows the known fields is skipped
+
+	if (entrySize < SignatureHeaderTraits::sectionEntrySize()) {
+		throw std::runtime_error("The signature section table is inconsistent");
+	}
+
+	auto entries = pos;
+	auto tableEnd = SignatureHeaderTraits::size() + SignatureHeaderTraits::sectionTableHeaderSize() +
+					static_cast<uint64_t>(sectionCount) * entrySize;
+
+	if (tableEnd > m_mapping.size()) {
+		throw std::runtime_error("The signature section table doesn't fit in the file");
+	}
+
+	m_sections.resize(sectionCount);
+
+	for (size_t i = 0; i < m_sections.size(); ++i) {
+		auto& section = m_sections[i];
+
+		pos = entries + i * entrySize;
+
+		get(section.id);
+		get(section.itemSize);
+		get(section.offset);
+		get(section.size);
+
+		if (section.offset < tableEnd || section.offset % SignatureHeaderTraits::sectionAlignment() ||
+			section.offset > m_mapping.size() || section.size > m_mapping.size() - section.offset) {
+			throw std::runtime_error("The signature section table is inconsistent");
+		}
+	}
+
+	// the sections of unknown kinds are skipped, and so are the ones the flags don't call for
+
+	m_digests = sectionData(SignatureSectionId::Digests, m_blockCount * m_digestSize);
+
+	if (hasMerkleTree()) {
+		m_levels = sectionData(SignatureSectionId::MerkleLevels, (m_tree.nodeCount() - m_blockCount) * m_digestSize);
+	}
+
+	if (hasWeakChecksums()) {
+		m_weakChecksums = sectionData(SignatureSectionId::WeakChecksums, m_blockCount * RollingChecksum::s_size);
+	}
+
+	if (hasBlockContents()) {
+		m_blockContents = sectionData(SignatureSectionId::BlockContents, m_blockCount);
+	}
+}
+
+// -------------------------------------------------------------------------- //
+
+const unsigned char* SignatureFile::sectionData (uint32_t id, uint64_t size) const {
+	auto section = SignatureSectionLayout::find(m_sections, id);
+
+	if (!section) {
+		throw std::runtime_error("The signature lacks a section its header calls for");
+	}
+
+	if (section->size != size) {
+		throw std::runtime_error("The signature section size doesn't match its header");
+	}
+
+	return m_window->data() + static_cast<size_t>(section->offset);
+}
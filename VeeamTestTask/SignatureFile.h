@@ -0,0 +1,112 @@
+#pragma once
+
+#include "FileSignatureCreator.h"
+#include "PlatformIO.h"
+#include "RollingChecksum.h"
+
+// -------------------------------------------------------------------------- //
+/*
+	SignatureFile class
+
+	maps an existing signature file into memory and validates its header and size,
+	gives access to the digests of the blocks and to the Merkle tree over them, if any,
+	as well as to the weak checksums and the contents of the blocks, if any; or to the records
+	of the chunks for a signature made of content-defined chunks
+
+	the parts of a signature of the version 4 are found through its section table,
+	and point right into the mapped file, every one of them at a page boundary
+
+	may throw:
+	- std::runtime_error - in case the file isn't a valid signature
+	- std::system_error - in case the file can't be opened or mapped
+ */
+// -------------------------------------------------------------------------- //
+
+class SignatureFile {
+public:
+
+	explicit SignatureFile (const path& filePath);
+
+	const SignatureHeader& header() const { return m_header; }
+
+	HashFunctionId hashFunctionId() const { return static_cast<HashFunctionId>(m_header.hashFunctionId); }
+	unsigned int digestSize() const { return m_digestSize; }
+	uint64_t blockCount() const { return m_blockCount; }
+
+	// the blocks of a fixed size
+
+	const unsigned char* digests() const { return m_digests; }
+	const unsigned char* digest (uint64_t block) const { return digests() + static_cast<size_t>(block * m_digestSize); }
+
+	bool hasMerkleTree() const { return (m_header.flags & SignatureFlags::MerkleTree) != 0; }
+	const MerkleTreeLayout& tree() const { return m_tree; }
+
+	const unsigned char* node (size_t level, uint64_t index) const {
+		if (!level) {
+			return digest(index);
+		}
+
+		return m_levels + static_cast<size_t>((m_tree.levelOffset(level) - m_blockCount + index) * m_digestSize);
+	}
+
+	// the digest of the whole file, if there is the tree
+	const unsigned char* root() const { return node(m_tree.levelCount() - 1, 0); }
+
+	bool hasWeakChecksums() const { return (m_header.flags & SignatureFlags::WeakChecksums) != 0; }
+	const unsigned char* weakChecksums() const { return m_weakChecksums; }
+
+	uint32_t weakChecksum (uint64_t block) const {
+		uint32_t checksum;
+
+		std::memcpy(&checksum, m_weakChecksums + static_cast<size_t>(block * RollingChecksum::s_size), sizeof(checksum));
+
+		return checksum;
+	}
+
+	bool hasBlockContents() const { return (m_header.flags & SignatureFlags::BlockContents) != 0; }
+	const unsigned char* blockContents() const { return m_blockContents; }
+
+	BlockContent blockContent (uint64_t block) const { return static_cast<BlockContent>(m_blockContents[static_cast<size_t>(block)]); }
+
+	bool isSectioned() const { return m_header.formatVersion == SignatureHeaderTraits::sectionedVersion(); }
+	const std::vector<SignatureSection>& sections() const { return m_sections; }
+
+	// the content-defined chunks
+
+	bool isChunked() const { return m_header.formatVersion == SignatureHeaderTraits::chunkedVersion(); }
+	uint64_t chunkCount() const { return m_blockCount; }
+	const ChunkSizes& chunkSizes() const { return m_chunkSizes; }
+
+	// the offset and the size of the chunk
+	byte_range_t chunk (uint64_t index) const;
+	const unsigned char* chunkDigest (uint64_t index) const { return chunkRecord(index) + SignatureHeaderTraits::chunkRecordSize(0); }
+
+private:
+
+	void readChunks();
+	void readSections();
+
+	// the data of the section of the given kind and size, which the flags say is there
+	const unsigned char* sectionData (uint32_t id, uint64_t size) const;
+
+	const unsigned char* chunkRecord (uint64_t index) const {
+		return digests() + static_cast<size_t>(index * SignatureHeaderTraits::chunkRecordSize(m_digestSize));
+	}
+
+private:
+
+	FileMapping m_mapping;
+	MappedWindowPtr m_window;
+
+	SignatureHeader m_header;
+	unsigned int m_digestSize{ 0 };
+	uint64_t m_blockCount{ 0 };
+	MerkleTreeLayout m_tree{ 0 };
+	std::vector<SignatureSection> m_sections;
+	ChunkSizes m_chunkSizes;
+
+	const unsigned char* m_digests{ nullptr };
+	const unsigned char* m_levels{ nullptr };
+	const unsigned char* m_weakChecksums{ nullptr };
+	const unsigned char* m_blockContents{ nullptr };
+};
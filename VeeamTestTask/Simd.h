@@ -0,0 +1,99 @@
+#pragma once
+
+// -------------------------------------------------------------------------- //
+/*
+	the pieces shared by the hand-written vectorized hashing kernels
+
+	the kernels are compiled for the instruction sets they need whatever the compiler
+	settings are, and are only ever called once the CPU has been checked for them;
+	the generic code instantiated for several instruction sets is inlined into
+	the entry points, which take on their target
+ */
+// -------------------------------------------------------------------------- //
+
+#include "CpuFeatures.h"
+
+#include <cstddef>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+#ifdef __GNUC__
+#define SIMD_TARGET_SSE2 __attribute__((target("sse2")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#define SIMD_TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw")))
+#define SIMD_ENTRY __attribute__((flatten))
+#else
+#define SIMD_TARGET_SSE2
+#define SIMD_TARGET_AVX2
+#define SIMD_TARGET_AVX512
+#define SIMD_ENTRY
+#endif
+
+// a kernel of a vectorized routine along with the instruction set it needs
+
+template <class Fn>
+struct SimdKernel {
+	SimdLevel level;
+	Fn fn;
+	const char* name;
+};
+
+// the first of the kernels, listed from the widest instruction set down to the plain C++ one,
+// the CPU may run; it's looked up on every call, so that a limit put on the level takes effect
+
+template <class Fn, size_t N>
+const SimdKernel<Fn>& selectKernel (const SimdKernel<Fn> (&kernels)[N]) {
+	auto level = CpuFeatures::simdLevel();
+
+	for (size_t i = 0; i + 1 < N; ++i) {
+		if (kernels[i].level <= level) {
+			return kernels[i];
+		}
+	}
+
+	return kernels[N - 1];
+}
+
+#ifdef SIMD_X86
+
+// turns four rows of four 32-bit words each into four columns
+
+SIMD_TARGET_SSE2 inline void transpose4x4 (__m128i r[4]) {
+	__m128i t0 = _mm_unpacklo_epi32(r[0], r[1]);
+	__m128i t1 = _mm_unpackhi_epi32(r[0], r[1]);
+	__m128i t2 = _mm_unpacklo_epi32(r[2], r[3]);
+	__m128i t3 = _mm_unpackhi_epi32(r[2], r[3]);
+
+	r[0] = _mm_unpacklo_epi64(t0, t2);
+	r[1] = _mm_unpackhi_epi64(t0, t2);
+	r[2] = _mm_unpacklo_epi64(t1, t3);
+	r[3] = _mm_unpackhi_epi64(t1, t3);
+}
+
+// turns eight rows of eight 32-bit words each into eight columns
+
+SIMD_TARGET_AVX2 inline void transpose8x8 (__m256i r[8]) {
+	__m256i t[8], u[8];
+
+	for (int i = 0; i < 8; i += 2) {
+		t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+		t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+	}
+
+	for (int i = 0; i < 8; i += 4) {
+		u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+		u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+		u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+		u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+	}
+
+	for (int i = 0; i < 4; ++i) {
+		r[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+		r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+	}
+}
+
+#endif
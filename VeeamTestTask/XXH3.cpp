@@ -0,0 +1,579 @@
+#include "stdafx.h"
+#include "XXH3.h"
+#include "Simd.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// the inputs are read as little-endian words, which is what all the supported platforms are
+
+namespace {
+
+constexpr uint64_t s_prime32_1{ 0x9E3779B1U };
+constexpr uint64_t s_prime32_2{ 0x85EBCA77U };
+constexpr uint64_t s_prime32_3{ 0xC2B2AE3DU };
+constexpr uint64_t s_prime64_1{ 0x9E3779B185EBCA87ULL };
+constexpr uint64_t s_prime64_2{ 0xC2B2AE3D27D4EB4FULL };
+constexpr uint64_t s_prime64_3{ 0x165667B19E3779F9ULL };
+constexpr uint64_t s_prime64_4{ 0x85EBCA77C2B2AE63ULL };
+constexpr uint64_t s_prime64_5{ 0x27D4EB2F165667C5ULL };
+constexpr uint64_t s_primeMx1{ 0x165667919E3779F9ULL };
+constexpr uint64_t s_primeMx2{ 0x9FB21C651E98DF25ULL };
+
+constexpr size_t s_secretSize{ 192 };
+constexpr size_t s_midSizeMax{ 240 };
+
+// the long inputs are consumed in 64-byte stripes, the secret is advanced by 8 bytes per stripe,
+// and the accumulators get scrambled once the whole secret has been gone through
+
+constexpr size_t s_stripeSize{ 64 };
+constexpr size_t s_secretConsumeRate{ 8 };
+constexpr size_t s_stripesPerBlock{ (s_secretSize - s_stripeSize) / s_secretConsumeRate };
+constexpr size_t s_blockSize{ s_stripeSize * s_stripesPerBlock };
+
+constexpr unsigned char s_secret[s_secretSize] = {
+	0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+	0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+	0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+	0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+	0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+	0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+	0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+	0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+	0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+	0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+	0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+	0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e
+};
+
+struct uint128_t {
+	uint64_t low;
+	uint64_t high;
+};
+
+inline uint32_t read32 (const unsigned char* p) {
+	uint32_t x;
+
+	std::memcpy(&x, p, sizeof(x));
+
+	return x;
+}
+
+inline uint64_t read64 (const unsigned char* p) {
+	uint64_t x;
+
+	std::memcpy(&x, p, sizeof(x));
+
+	return x;
+}
+
+inline void writeBigEndian (uint64_t x, unsigned char* p) {
+	for (int i = 7; i >= 0; --i, x >>= 8) {
+		p[i] = static_cast<unsigned char>(x);
+	}
+}
+
+inline uint32_t swap32 (uint32_t x) {
+	return (x << 24) | ((x << 8) & 0x00ff0000) | ((x >> 8) & 0x0000ff00) | (x >> 24);
+}
+
+inline uint64_t swap64 (uint64_t x) {
+	return (static_cast<uint64_t>(swap32(static_cast<uint32_t>(x))) << 32) | swap32(static_cast<uint32_t>(x >> 32));
+}
+
+inline uint32_t rotl32 (uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+inline uint64_t rotl64 (uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint128_t multiply (uint64_t a, uint64_t b) {
+	uint128_t r;
+#if defined(_MSC_VER) && defined(_M_X64)
+	r.low = _umul128(a, b, &r.high);
+#elif defined(__SIZEOF_INT128__)
+	auto product = static_cast<unsigned __int128>(a) * b;
+
+	r.low = static_cast<uint64_t>(product);
+	r.high = static_cast<uint64_t>(product >> 64);
+#else
+	auto loLo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+	auto hiLo = (a >> 32) * (b & 0xFFFFFFFF);
+	auto loHi = (a & 0xFFFFFFFF) * (b >> 32);
+	auto hiHi = (a >> 32) * (b >> 32);
+	auto cross = (loLo >> 32) + (hiLo & 0xFFFFFFFF) + loHi;
+
+	r.low = (cross << 32) | (loLo & 0xFFFFFFFF);
+	r.high = (hiLo >> 32) + (cross >> 32) + hiHi;
+#endif
+	return r;
+}
+
+inline uint64_t multiplyFold (uint64_t a, uint64_t b) {
+	auto product = multiply(a, b);
+
+	return product.low ^ product.high;
+}
+
+inline uint64_t xxh64Avalanche (uint64_t h) {
+	h ^= h >> 33;
+	h *= s_prime64_2;
+	h ^= h >> 29;
+	h *= s_prime64_3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+inline uint64_t avalanche (uint64_t h) {
+	h ^= h >> 37;
+	h *= s_primeMx1;
+	h ^= h >> 32;
+
+	return h;
+}
+
+inline uint64_t rrmxmx (uint64_t h, uint64_t length) {
+	h ^= rotl64(h, 49) ^ rotl64(h, 24);
+	h *= s_primeMx2;
+	h ^= (h >> 35) + length;
+	h *= s_primeMx2;
+	h ^= h >> 28;
+
+	return h;
+}
+
+inline uint64_t mix16 (const unsigned char* input, const unsigned char* secret) {
+	return multiplyFold(read64(input) ^ read64(secret), read64(input + 8) ^ read64(secret + 8));
+}
+
+inline void mix32 (uint128_t& acc, const unsigned char* input1, const unsigned char* input2,
+				   const unsigned char* secret) {
+	acc.low += mix16(input1, secret);
+	acc.low ^= read64(input2) + read64(input2 + 8);
+	acc.high += mix16(input2, secret + 16);
+	acc.high ^= read64(input1) + read64(input1 + 8);
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	ScalarAccumulators, SSE2Accumulators, AVX2Accumulators and AVX512Accumulators classes
+
+	the eight 64-bit accumulators of the long inputs, held in as many vectors as it takes,
+	and the two operations done on them: taking in a stripe and scrambling
+ */
+// -------------------------------------------------------------------------- //
+
+struct ScalarAccumulators {
+	using vec_t = uint64_t;
+
+	static constexpr size_t s_count{ 8 };
+
+	static void accumulate (vec_t acc[], const unsigned char* input, const unsigned char* secret) {
+		for (size_t i = 0; i < s_count; ++i) {
+			auto data = read64(input + i * 8);
+			auto key = data ^ read64(secret + i * 8);
+
+			acc[i ^ 1] += data;
+			acc[i] += (key & 0xFFFFFFFF) * (key >> 32);
+		}
+	}
+
+	static void scramble (vec_t acc[], const unsigned char* secret) {
+		for (size_t i = 0; i < s_count; ++i) {
+			auto a = acc[i];
+
+			a ^= a >> 47;
+			a ^= read64(secret + i * 8);
+			a *= s_prime32_1;
+
+			acc[i] = a;
+		}
+	}
+};
+
+#ifdef SIMD_X86
+
+struct SSE2Accumulators {
+	using vec_t = __m128i;
+
+	static constexpr size_t s_count{ 4 };
+
+	static SIMD_TARGET_SSE2 void accumulate (vec_t acc[], const unsigned char* input, const unsigned char* secret) {
+		for (size_t i = 0; i < s_count; ++i) {
+			auto data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input) + i);
+			auto key = _mm_xor_si128(data, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i));
+			auto product = _mm_mul_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+
+			acc[i] = _mm_add_epi64(product, _mm_add_epi64(acc[i], _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2))));
+		}
+	}
+
+	static SIMD_TARGET_SSE2 void scramble (vec_t acc[], const unsigned char* secret) {
+		const __m128i prime = _mm_set1_epi32(static_cast<int>(s_prime32_1));
+
+		for (size_t i = 0; i < s_count; ++i) {
+			auto a = _mm_xor_si128(acc[i], _mm_srli_epi64(acc[i], 47));
+			auto key = _mm_xor_si128(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i));
+			auto productLo = _mm_mul_epu32(key, prime);
+			auto productHi = _mm_mul_epu32(_mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+
+			acc[i] = _mm_add_epi64(productLo, _mm_slli_epi64(productHi, 32));
+		}
+	}
+};
+
+// -------------------------------------------------------------------------- //
+
+struct AVX2Accumulators {
+	using vec_t = __m256i;
+
+	static constexpr size_t s_count{ 2 };
+
+	static SIMD_TARGET_AVX2 void accumulate (vec_t acc[], const unsigned char* input, const unsigned char* secret) {
+		for (size_t i = 0; i < s_count; ++i) {
+			auto data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input) + i);
+			auto key = _mm256_xor_si256(data, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i));
+			auto product = _mm256_mul_epu32(key, _mm256_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+
+			acc[i] = _mm256_add_epi64(product, _mm256_add_epi64(acc[i], _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2))));
+		}
+	}
+
+	static SIMD_TARGET_AVX2 void scramble (vec_t acc[], const unsigned char* secret) {
+		const __m256i prime = _mm256_set1_epi32(static_cast<int>(s_prime32_1));
+
+		for (size_t i = 0; i < s_count; ++i) {
+			auto a = _mm256_xor_si256(acc[i], _mm256_srli_epi64(acc[i], 47));
+			auto key = _mm256_xor_si256(a, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i));
+			auto productLo = _mm256_mul_epu32(key, prime);
+			auto productHi = _mm256_mul_epu32(_mm256_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+
+			acc[i] = _mm256_add_epi64(productLo, _mm256_slli_epi64(productHi, 32));
+		}
+	}
+};
+
+// -------------------------------------------------------------------------- //
+
+struct AVX512Accumulators {
+	using vec_t = __m512i;
+
+	static constexpr size_t s_count{ 1 };
+
+	static SIMD_TARGET_AVX512 void accumulate (vec_t acc[], const unsigned char* input, const unsigned char* secret) {
+		auto data = _mm512_loadu_si512(input);
+		auto key = _mm512_xor_si512(data, _mm512_loadu_si512(secret));
+		auto product = _mm512_mul_epu32(key, _mm512_srli_epi64(key, 32));
+
+		acc[0] = _mm512_add_epi64(product, _mm512_add_epi64(acc[0], _mm512_shuffle_epi32(data, static_cast<_MM_PERM_ENUM>(_MM_SHUFFLE(1, 0, 3, 2)))));
+	}
+
+	static SIMD_TARGET_AVX512 void scramble (vec_t acc[], const unsigned char* secret) {
+		const __m512i prime = _mm512_set1_epi32(static_cast<int>(s_prime32_1));
+
+		// acc ^ (acc >> 47) ^ secret
+		auto key = _mm512_ternarylogic_epi32(_mm512_loadu_si512(secret), acc[0], _mm512_srli_epi64(acc[0], 47), 0x96);
+		auto productLo = _mm512_mul_epu32(key, prime);
+		auto productHi = _mm512_mul_epu32(_mm512_srli_epi64(key, 32), prime);
+
+		acc[0] = _mm512_add_epi64(productLo, _mm512_slli_epi64(productHi, 32));
+	}
+};
+
+#endif
+
+// runs all the stripes of a long input through the accumulators
+
+template <class Accumulators>
+void accumulateLong (uint64_t state[8], const unsigned char* input, size_t size) {
+	typename Accumulators::vec_t acc[Accumulators::s_count];
+
+	std::memcpy(acc, state, sizeof(acc));
+
+	auto blockCount = (size - 1) / s_blockSize;
+
+	for (size_t n = 0; n < blockCount; ++n) {
+		for (size_t s = 0; s < s_stripesPerBlock; ++s) {
+			Accumulators::accumulate(acc, input + n * s_blockSize + s * s_stripeSize, s_secret + s * s_secretConsumeRate);
+		}
+
+		Accumulators::scramble(acc, s_secret + s_secretSize - s_stripeSize);
+	}
+
+	// the stripes of the last partial block, and then the very last stripe,
+	// which may overlap the ones before it
+
+	auto stripeCount = ((size - 1) - blockCount * s_blockSize) / s_stripeSize;
+
+	for (size_t s = 0; s < stripeCount; ++s) {
+		Accumulators::accumulate(acc, input + blockCount * s_blockSize + s * s_stripeSize, s_secret + s * s_secretConsumeRate);
+	}
+
+	Accumulators::accumulate(acc, input + size - s_stripeSize, s_secret + s_secretSize - s_stripeSize - 7);
+
+	std::memcpy(state, acc, sizeof(acc));
+}
+
+using accumulate_fn_t = void (*)(uint64_t state[8], const unsigned char* input, size_t size);
+
+void accumulateScalar (uint64_t state[8], const unsigned char* input, size_t size) {
+	accumulateLong<ScalarAccumulators>(state, input, size);
+}
+
+#ifdef SIMD_X86
+
+SIMD_TARGET_SSE2 SIMD_ENTRY
+void accumulateSSE2 (uint64_t state[8], const unsigned char* input, size_t size) {
+	accumulateLong<SSE2Accumulators>(state, input, size);
+}
+
+SIMD_TARGET_AVX2 SIMD_ENTRY
+void accumulateAVX2 (uint64_t state[8], const unsigned char* input, size_t size) {
+	accumulateLong<AVX2Accumulators>(state, input, size);
+}
+
+SIMD_TARGET_AVX512 SIMD_ENTRY
+void accumulateAVX512 (uint64_t state[8], const unsigned char* input, size_t size) {
+	accumulateLong<AVX512Accumulators>(state, input, size);
+}
+
+#endif
+
+const SimdKernel<accumulate_fn_t> s_longKernels[] = {
+#ifdef SIMD_X86
+	{ SimdLevel::AVX512, &accumulateAVX512, "AVX-512" },
+	{ SimdLevel::AVX2, &accumulateAVX2, "AVX2" },
+	{ SimdLevel::SSE2, &accumulateSSE2, "SSE2" },
+#endif
+	{ SimdLevel::None, &accumulateScalar, "C++" }
+};
+
+uint64_t mergeAccumulators (const uint64_t state[8], const unsigned char* secret, uint64_t start) {
+	auto result = start;
+
+	for (size_t i = 0; i < 4; ++i) {
+		result += multiplyFold(state[2 * i] ^ read64(secret + 16 * i), state[2 * i + 1] ^ read64(secret + 16 * i + 8));
+	}
+
+	return avalanche(result);
+}
+
+void hashLong (const unsigned char* input, size_t size, uint64_t state[8]) {
+	const uint64_t initialState[8] = {
+		s_prime32_3, s_prime64_1, s_prime64_2, s_prime64_3, s_prime64_4, s_prime32_2, s_prime64_5, s_prime32_1
+	};
+
+	std::memcpy(state, initialState, sizeof(initialState));
+
+	selectKernel(s_longKernels).fn(state, input, size);
+}
+
+// -------------------------------------------------------------------------- //
+
+uint64_t hash64Short (const unsigned char* input, size_t size) {
+	if (size > 8) {
+		auto bitflip1 = read64(s_secret + 24) ^ read64(s_secret + 32);
+		auto bitflip2 = read64(s_secret + 40) ^ read64(s_secret + 48);
+		auto lo = read64(input) ^ bitflip1;
+		auto hi = read64(input + size - 8) ^ bitflip2;
+
+		return avalanche(size + swap64(lo) + hi + multiplyFold(lo, hi));
+	}
+
+	if (size >= 4) {
+		auto bitflip = read64(s_secret + 8) ^ read64(s_secret + 16);
+		auto combined = read32(input + size - 4) + (static_cast<uint64_t>(read32(input)) << 32);
+
+		return rrmxmx(combined ^ bitflip, size);
+	}
+
+	if (size) {
+		auto combined = (static_cast<uint32_t>(input[0]) << 16) | (static_cast<uint32_t>(input[size >> 1]) << 24) |
+						 static_cast<uint32_t>(input[size - 1]) | (static_cast<uint32_t>(size) << 8);
+		auto bitflip = static_cast<uint64_t>(read32(s_secret) ^ read32(s_secret + 4));
+
+		return xxh64Avalanche(combined ^ bitflip);
+	}
+
+	return xxh64Avalanche(read64(s_secret + 56) ^ read64(s_secret + 64));
+}
+
+uint64_t hash64Medium (const unsigned char* input, size_t size) {
+	uint64_t acc = size * s_prime64_1;
+
+	if (size <= 128) {
+		if (size > 32) {
+			if (size > 64) {
+				if (size > 96) {
+					acc += mix16(input + 48, s_secret + 96);
+					acc += mix16(input + size - 64, s_secret + 112);
+				}
+
+				acc += mix16(input + 32, s_secret + 64);
+				acc += mix16(input + size - 48, s_secret + 80);
+			}
+
+			acc += mix16(input + 16, s_secret + 32);
+			acc += mix16(input + size - 32, s_secret + 48);
+		}
+
+		acc += mix16(input, s_secret);
+		acc += mix16(input + size - 16, s_secret + 16);
+
+		return avalanche(acc);
+	}
+
+	for (size_t i = 0; i < 8; ++i) {
+		acc += mix16(input + 16 * i, s_secret + 16 * i);
+	}
+
+	acc = avalanche(acc);
+
+	for (size_t i = 8; i < size / 16; ++i) {
+		acc += mix16(input + 16 * i, s_secret + 16 * (i - 8) + 3);
+	}
+
+	acc += mix16(input + size - 16, s_secret + 136 - 17);
+
+	return avalanche(acc);
+}
+
+uint128_t hash128Short (const unsigned char* input, size_t size) {
+	uint128_t h;
+
+	if (size > 8) {
+		auto bitflipLo = read64(s_secret + 32) ^ read64(s_secret + 40);
+		auto bitflipHi = read64(s_secret + 48) ^ read64(s_secret + 56);
+		auto lo = read64(input);
+		auto hi = read64(input + size - 8);
+		auto m = multiply(lo ^ hi ^ bitflipLo, s_prime64_1);
+
+		m.low += static_cast<uint64_t>(size - 1) << 54;
+		hi ^= bitflipHi;
+		m.high += hi + (hi & 0xFFFFFFFF) * (s_prime32_2 - 1);
+		m.low ^= swap64(m.high);
+
+		h = multiply(m.low, s_prime64_2);
+		h.high += m.high * s_prime64_2;
+		h.low = avalanche(h.low);
+		h.high = avalanche(h.high);
+	} else if (size >= 4) {
+		auto bitflip = read64(s_secret + 16) ^ read64(s_secret + 24);
+		auto combined = read32(input) + (static_cast<uint64_t>(read32(input + size - 4)) << 32);
+
+		h = multiply(combined ^ bitflip, s_prime64_1 + (size << 2));
+		h.high += h.low << 1;
+		h.low ^= h.high >> 3;
+		h.low ^= h.low >> 35;
+		h.low *= s_primeMx2;
+		h.low ^= h.low >> 28;
+		h.high = avalanche(h.high);
+	} else if (size) {
+		auto combinedLo = (static_cast<uint32_t>(input[0]) << 16) | (static_cast<uint32_t>(input[size >> 1]) << 24) |
+						   static_cast<uint32_t>(input[size - 1]) | (static_cast<uint32_t>(size) << 8);
+		auto combinedHi = rotl32(swap32(combinedLo), 13);
+		auto bitflipLo = static_cast<uint64_t>(read32(s_secret) ^ read32(s_secret + 4));
+		auto bitflipHi = static_cast<uint64_t>(read32(s_secret + 8) ^ read32(s_secret + 12));
+
+		h.low = xxh64Avalanche(combinedLo ^ bitflipLo);
+		h.high = xxh64Avalanche(combinedHi ^ bitflipHi);
+	} else {
+		h.low = xxh64Avalanche(read64(s_secret + 64) ^ read64(s_secret + 72));
+		h.high = xxh64Avalanche(read64(s_secret + 80) ^ read64(s_secret + 88));
+	}
+
+	return h;
+}
+
+uint128_t hash128Medium (const unsigned char* input, size_t size) {
+	uint128_t acc{ size * s_prime64_1, 0 };
+
+	if (size <= 128) {
+		if (size > 32) {
+			if (size > 64) {
+				if (size > 96) {
+					mix32(acc, input + 48, input + size - 64, s_secret + 96);
+				}
+
+				mix32(acc, input + 32, input + size - 48, s_secret + 64);
+			}
+
+			mix32(acc, input + 16, input + size - 32, s_secret + 32);
+		}
+
+		mix32(acc, input, input + size - 16, s_secret);
+	} else {
+		for (size_t i = 32; i < 160; i += 32) {
+			mix32(acc, input + i - 32, input + i - 16, s_secret + i - 32);
+		}
+
+		acc.low = avalanche(acc.low);
+		acc.high = avalanche(acc.high);
+
+		for (size_t i = 160; i <= size; i += 32) {
+			mix32(acc, input + i - 32, input + i - 16, s_secret + 3 + i - 160);
+		}
+
+		mix32(acc, input + size - 16, input + size - 32, s_secret + 136 - 17 - 16);
+	}
+
+	uint128_t h;
+
+	h.low = avalanche(acc.low + acc.high);
+	h.high = 0 - avalanche(acc.low * s_prime64_1 + acc.high * s_prime64_4 + size * s_prime64_2);
+
+	return h;
+}
+
+}
+
+// -------------------------------------------------------------------------- //
+/*
+	XXH3 methods implementation
+ */
+// -------------------------------------------------------------------------- //
+
+void XXH3::hash64 (const unsigned char* input, size_t size, unsigned char* digest) {
+	uint64_t h;
+
+	if (size <= 16) {
+		h = hash64Short(input, size);
+	} else if (size <= s_midSizeMax) {
+		h = hash64Medium(input, size);
+	} else {
+		uint64_t state[8];
+
+		hashLong(input, size, state);
+
+		h = mergeAccumulators(state, s_secret + 11, size * s_prime64_1);
+	}
+
+	writeBigEndian(h, digest);
+}
+
+// -------------------------------------------------------------------------- //
+
+void XXH3::hash128 (const unsigned char* input, size_t size, unsigned char* digest) {
+	uint128_t h;
+
+	if (size <= 16) {
+		h = hash128Short(input, size);
+	} else if (size <= s_midSizeMax) {
+		h = hash128Medium(input, size);
+	} else {
+		uint64_t state[8];
+
+		hashLong(input, size, state);
+
+		h.low = mergeAccumulators(state, s_secret + 11, size * s_prime64_1);
+		h.high = mergeAccumulators(state, s_secret + s_secretSize - sizeof(state) - 11, ~(size * s_prime64_2));
+	}
+
+	writeBigEndian(h.high, digest);
+	writeBigEndian(h.low, digest + sizeof(uint64_t));
+}
+
+// -------------------------------------------------------------------------- //
+
+const char* XXH3::kernelName() {
+	return selectKernel(s_longKernels).name;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// -------------------------------------------------------------------------- //
+/*
+	XXH3 class
+
+	the 64-bit and the 128-bit flavours of the XXH3 non-cryptographic hash function
+	with the default secret and no seed, the results match the reference implementation
+
+	the digests are stored in the canonical (big-endian) form, the stripes of the inputs
+	longer than 240 bytes are accumulated in the vector registers
+ */
+// -------------------------------------------------------------------------- //
+
+class XXH3 {
+public:
+
+	static constexpr unsigned int s_digestSize64{ 8 };
+	static constexpr unsigned int s_digestSize128{ 16 };
+
+	static void hash64 (const unsigned char* input, size_t size, unsigned char* digest);
+	static void hash128 (const unsigned char* input, size_t size, unsigned char* digest);
+
+	static const char* kernelName();
+};
@@ -1,9 +1,75 @@
 #pragma once
 
-using buffer_t = std::vector<unsigned char>;
+#include <new>
+#include <cstdlib>
+
+// allocates the memory aligned to the given boundary, which lets the buffers
+// serve as targets of the unbuffered I/O
+
+template <class T, size_t Alignment>
+struct AlignedAllocator {
+	using value_type = T;
+
+	template <class U>
+	struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+	AlignedAllocator() = default;
+
+	template <class U>
+	AlignedAllocator (const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate (size_t n) {
+#ifdef _MSC_VER
+		// the aligned operator new is only available to MSVC in the C++17 mode
+		auto p = _aligned_malloc(n * sizeof(T), Alignment);
+
+		if (!p) {
+			throw std::bad_alloc{};
+		}
+
+		return static_cast<T*>(p);
+#else
+		return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{ Alignment }));
+#endif
+	}
+
+	void deallocate (T* p, size_t) {
+#ifdef _MSC_VER
+		_aligned_free(p);
+#else
+		::operator delete(p, std::align_val_t{ Alignment });
+#endif
+	}
+
+	template <class U>
+	bool operator== (const AlignedAllocator<U, Alignment>&) const { return true; }
+	template <class U>
+	bool operator!= (const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+constexpr size_t bufferAlignment{ 4096 };
+
+using buffer_t = std::vector<unsigned char, AlignedAllocator<unsigned char, bufferAlignment>>;
 using hash_t = std::vector<unsigned char>;
 
 enum class HashFunctionId : uint16_t {
 	CRC32 = 0,
-	MD5 = 1
+	MD5 = 1,
+	CRC32C = 2,
+	BLAKE2b = 3,
+	BLAKE2s = 4,
+	SHA256 = 5,
+	XXH3 = 6,
+	XXH128 = 7,
+	BLAKE3 = 8
+};
+
+// what a block is made of as far as the hashers can tell, the blocks of a uniform content
+// get their digests cached rather than computed; these are also the per-block flags
+// a signature may store
+
+enum class BlockContent : uint8_t {
+	Data = 0,
+	Zeros = 1,
+	Pattern = 2
 };
\ No newline at end of file